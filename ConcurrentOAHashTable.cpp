@@ -0,0 +1,487 @@
+/******************************************************************************
+ * @file ConcurrentOAHashTable.cpp
+ * @author Jay Sharma
+ * @brief Implementation for a thread-safe wrapper around OAHashTable that
+ *  splits the keys across independently locked shards
+ * @version 0.1
+ * @date 2026-10-16
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ *****************************************************************************/
+
+#include "ConcurrentOAHashTable.h"
+#include <algorithm>
+#include <functional>
+#include <optional>
+#include <vector>
+
+/******************************************************************************
+ * @brief Construct a new ConcurrentOAHashTable<T>::ConcurrentOAHashTable
+ *  object. Every shard gets a copy of Config with the initial size split
+ *  between them. Shards is rounded up to a power of two; zero picks four
+ *  shards per hardware thread.
+ * 
+ * @tparam T 
+ * @param Config 
+ * @param Shards 
+ *****************************************************************************/
+template<class T> ConcurrentOAHashTable<T>::
+ConcurrentOAHashTable(const typename OAHashTable<T>::OAHTConfig &Config,
+  unsigned Shards)
+: shards(0), shard_count(0), readers(0), reader_count(0)
+{
+  unsigned threads = std::thread::hardware_concurrency();
+  if (threads == 0)
+  {
+    threads = 1;
+  }
+  if (Shards == 0)
+  {
+    Shards = threads * 4;
+  }
+
+  shard_count = NextPowerOfTwo(Shards);
+  reader_count = NextPowerOfTwo(threads);
+
+  // Each shard starts with its share of the requested size
+  typename OAHashTable<T>::OAHTConfig shard_config(Config);
+  unsigned shard_size = Config.InitialTableSize_ / shard_count;
+  if (shard_size < 7)
+  {
+    shard_size = 7;
+  }
+  shard_config.InitialTableSize_ = GetClosestPrime(shard_size);
+
+  try
+  {
+    shards = new Shard[shard_count];
+    for (unsigned i = 0; i < shard_count; ++i)
+    {
+      shards[i].table = 0;
+    }
+
+    readers = new ReaderSlot[reader_count];
+    for (unsigned i = 0; i < shard_count; ++i)
+    {
+      shards[i].table = new OAHashTable<T>(shard_config);
+    }
+  }
+  catch(const std::bad_alloc&)
+  {
+    Release();
+    throw (OAHashTableException(OAHashTableException::E_NO_MEMORY,
+      "The table does not have enough memory"));
+  }
+  catch(...)
+  {
+    Release();
+    throw;
+  }
+
+  for (unsigned i = 0; i < shard_count; ++i)
+  {
+    shards[i].writing.store(false, std::memory_order_relaxed);
+  }
+  for (unsigned i = 0; i < reader_count; ++i)
+  {
+    readers[i].Probes_.store(0, std::memory_order_relaxed);
+    readers[i].Shard_.store(0, std::memory_order_relaxed);
+  }
+}
+
+/******************************************************************************
+ * @brief Destroy the ConcurrentOAHashTable<T>::ConcurrentOAHashTable object
+ * 
+ * @tparam T 
+ *****************************************************************************/
+template<class T> ConcurrentOAHashTable<T>::~ConcurrentOAHashTable()
+{
+  Release();
+}
+
+/******************************************************************************
+ * @brief Inserts a Key/Data pair into the table. Only the key's shard is
+ * locked, so writers to different shards never wait on each other. Throws
+ * an exception if the data cannot be inserted. (E_DUPLICATE, E_NO_MEMORY)
+ * 
+ * @tparam T 
+ * @param Key 
+ * @param Data 
+ *****************************************************************************/
+template<class T> void ConcurrentOAHashTable<T>::insert(const char *Key,
+  const T &Data)
+{
+  Shard& shard = GetShard(Key);
+  std::unique_lock<std::shared_mutex> lock(shard.lock);
+  ExcludeReaders(shard);
+
+  try
+  {
+    shard.table->insert(Key, Data);
+  }
+  catch(...)
+  {
+    shard.writing.store(false, std::memory_order_release);
+    throw;
+  }
+  shard.writing.store(false, std::memory_order_release);
+}
+
+/******************************************************************************
+ * @brief Removes a Key/Data pair by key. Throws an exception if the pair
+ * cannot be removed. (E_ITEM_NOT_FOUND)
+ * 
+ * @tparam T 
+ * @param Key 
+ *****************************************************************************/
+template<class T> void ConcurrentOAHashTable<T>::remove(const char *Key)
+{
+  Shard& shard = GetShard(Key);
+  std::unique_lock<std::shared_mutex> lock(shard.lock);
+  ExcludeReaders(shard);
+
+  try
+  {
+    shard.table->remove(Key);
+  }
+  catch(...)
+  {
+    shard.writing.store(false, std::memory_order_release);
+    throw;
+  }
+  shard.writing.store(false, std::memory_order_release);
+}
+
+/******************************************************************************
+ * @brief Finds the data by key and returns a copy of it, since a reference
+ * could be invalidated by another thread as soon as the read ends. Throws 
+ * an exception if Key isn't found. (E_ITEM_NOT_FOUND)
+ * 
+ * @tparam T 
+ * @param Key 
+ * @return T 
+ *****************************************************************************/
+template<class T> T ConcurrentOAHashTable<T>::find(const char *Key) const
+{
+  std::optional<T> result;
+  if (!Read(Key, [&result](const T &Data) { result.emplace(Data); }))
+  {
+    throw(OAHashTableException(OAHashTableException::E_ITEM_NOT_FOUND,
+      "Item not found in table."));
+  }
+
+  return std::move(*result);
+}
+
+/******************************************************************************
+ * @brief Finds the data by key and copies it into Result. Returns false, 
+ * leaving Result alone, if Key isn't found, so misses cost no exception.
+ * 
+ * @tparam T 
+ * @param Key 
+ * @param Result 
+ * @return bool 
+ *****************************************************************************/
+template<class T> bool ConcurrentOAHashTable<T>::try_find(const char *Key,
+  T &Result) const
+{
+  return Read(Key, [&Result](const T &Data) { Result = Data; });
+}
+
+/******************************************************************************
+ * @brief Looks up Key and, if it is there, passes its data to Visit while 
+ * the shard is still protected. Readers do not take the shard lock: a 
+ * reader marks the shard in its own thread's slot and goes ahead unless a 
+ * writer holds the shard, so reads of any shard run in parallel and only 
+ * ever write the reader's own cache line. Writers wait for marked readers 
+ * to finish (see ExcludeReaders). When a writer is active, or the slot is 
+ * taken by another thread, the reader falls back to a shared lock.
+ * 
+ * @tparam T 
+ * @tparam F 
+ * @param Key 
+ * @param Visit // called with the data, only if Key is found
+ * @return bool // true if Key was found
+ *****************************************************************************/
+template<class T> template<class F>
+bool ConcurrentOAHashTable<T>::Read(const char *Key, const F &Visit) const
+{
+  const Shard& shard = GetShard(Key);
+  ReaderSlot& slot = ThreadSlot();
+  unsigned mark = static_cast<unsigned>(&shard - shards) + 1;
+  unsigned probes = 0;
+
+  // The mark must be visible before the writer flag is checked, and a 
+  // writer sets its flag before checking the marks, so one of the two 
+  // always sees the other
+  unsigned free_slot = 0;
+  if (slot.Shard_.compare_exchange_strong(free_slot, mark))
+  {
+    if (!shard.writing.load())
+    {
+      try
+      {
+        const T *data = shard.table->lookup(Key, probes);
+        if (data)
+        {
+          Visit(*data);
+        }
+        slot.Shard_.store(0, std::memory_order_release);
+        CountProbes(probes);
+        return data != 0;
+      }
+      catch(...)
+      {
+        slot.Shard_.store(0, std::memory_order_release);
+        throw;
+      }
+    }
+    slot.Shard_.store(0, std::memory_order_release);
+  }
+
+  std::shared_lock<std::shared_mutex> lock(shard.lock);
+  const T *data = shard.table->lookup(Key, probes);
+  if (data)
+  {
+    Visit(*data);
+  }
+  lock.unlock();
+  CountProbes(probes);
+
+  return data != 0;
+}
+
+/******************************************************************************
+ * @brief Removes all Key/Data pairs in every shard
+ * 
+ * @tparam T 
+ *****************************************************************************/
+template<class T> void ConcurrentOAHashTable<T>::clear()
+{
+  for (unsigned i = 0; i < shard_count; ++i)
+  {
+    std::unique_lock<std::shared_mutex> lock(shards[i].lock);
+    ExcludeReaders(shards[i]);
+    shards[i].table->clear();
+    shards[i].writing.store(false, std::memory_order_release);
+  }
+}
+
+/******************************************************************************
+ * @brief Returns the stats of all shards added together, plus the probes
+ * counted by readers. Writer probes (insert, remove) are counted by the 
+ * shard's own table, so they come in with the shard stats, histogram and 
+ * all. Reader probes only go into Probes_, not the probe length histogram. 
+ * Shards are locked one at a time, so under concurrent writes the result 
+ * is not a single point-in-time snapshot. PeakBytes_ is the sum of each 
+ * shard's peak, an upper bound since shards rarely peak together. Scan is 
+ * passed on to each shard; see OAHashTable::GetStats.
+ * 
+ * @tparam T 
+ * @param Scan // walk every shard for the cluster and probe length fields 
+ * @return OAHTStats 
+ *****************************************************************************/
+template<class T> OAHTStats ConcurrentOAHashTable<T>::GetStats(bool Scan) const
+{
+  OAHTStats total;
+  double probe_length_sum = 0.0;
+
+  for (unsigned i = 0; i < shard_count; ++i)
+  {
+    // GetStats only reads the shard, so it can run alongside readers
+    std::shared_lock<std::shared_mutex> lock(shards[i].lock);
+    OAHTStats stats = shards[i].table->GetStats(Scan);
+    lock.unlock();
+
+    total.Count_ += stats.Count_;
+    total.TableSize_ += stats.TableSize_;
+    total.Probes_ += stats.Probes_;
+    total.Expansions_ += stats.Expansions_;
+    total.Compactions_ += stats.Compactions_;
+    total.Tombstones_ += stats.Tombstones_;
+    total.Bytes_ += stats.Bytes_;
+    total.PeakBytes_ += stats.PeakBytes_;
+    total.PrimaryHashFunc_ = stats.PrimaryHashFunc_;
+    total.SecondaryHashFunc_ = stats.SecondaryHashFunc_;
+    probe_length_sum += stats.MeanProbeLength_ * stats.Count_;
+    if (stats.MaxProbeLength_ > total.MaxProbeLength_)
+    {
+      total.MaxProbeLength_ = stats.MaxProbeLength_;
+    }
+    if (stats.LongestCluster_ > total.LongestCluster_)
+    {
+      total.LongestCluster_ = stats.LongestCluster_;
+    }
+    for (unsigned j = 0; j < OAHT_HISTOGRAM_BUCKETS; ++j)
+    {
+      total.ProbeHistogram_[j] += stats.ProbeHistogram_[j];
+    }
+  }
+
+  if (total.Count_)
+  {
+    total.MeanProbeLength_ = probe_length_sum / total.Count_;
+  }
+  if (total.TableSize_)
+  {
+    total.TombstoneRatio_ = 
+      static_cast<double>(total.Tombstones_) / total.TableSize_;
+  }
+
+  for (unsigned i = 0; i < reader_count; ++i)
+  {
+    total.Probes_ += static_cast<unsigned>(
+      readers[i].Probes_.load(std::memory_order_relaxed));
+  }
+
+  return total;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//--  HELPER FUNCTIONS  --/////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+/******************************************************************************
+ * @brief Helper function that picks the shard for a key from the low bits 
+ *  of the built-in string hash of the whole key. Every byte counts, so keys 
+ *  that share a long prefix still spread over all shards, and the hash is 
+ *  unrelated to the shard tables' own hash functions.
+ * 
+ * @tparam T 
+ * @param Key 
+ * @return ConcurrentOAHashTable<T>::Shard& 
+ *****************************************************************************/
+template<class T> typename ConcurrentOAHashTable<T>::Shard&
+ConcurrentOAHashTable<T>::GetShard(const char *Key) const
+{
+  return shards[OAHTStringHash::Hash(Key) & (shard_count - 1)];
+}
+
+/******************************************************************************
+ * @brief Helper function that returns the calling thread's reader slot. 
+ *  Slots sit on their own cache lines, so readers on different threads do 
+ *  not contend. A thread takes an index on its first read and gives it back 
+ *  when it exits, and new threads reuse the lowest free index, so a pool 
+ *  that keeps replacing its threads does not run the indices up. The index 
+ *  belongs to the thread, not the table: it is shared by every table with 
+ *  the same T, each of which picks the slot from its own array. When more 
+ *  threads are alive than a table has slots, some of them share a slot; 
+ *  they stay correct (see Read) but contend on its cache line.
+ * 
+ * @tparam T 
+ * @return ConcurrentOAHashTable<T>::ReaderSlot& 
+ *****************************************************************************/
+template<class T> typename ConcurrentOAHashTable<T>::ReaderSlot&
+ConcurrentOAHashTable<T>::ThreadSlot() const
+{
+  static std::mutex index_lock;
+  static std::vector<unsigned> free_indices;
+  static unsigned next_index = 0;
+
+  // Takes an index for the calling thread and frees it on thread exit
+  struct ThreadIndex
+  {
+    ThreadIndex()
+    {
+      std::lock_guard<std::mutex> lock(index_lock);
+      if (free_indices.empty())
+      {
+        Index_ = next_index++;
+        return;
+      }
+      std::pop_heap(free_indices.begin(), free_indices.end(), 
+        std::greater<unsigned>());
+      Index_ = free_indices.back();
+      free_indices.pop_back();
+    }
+
+    ~ThreadIndex()
+    {
+      std::lock_guard<std::mutex> lock(index_lock);
+      free_indices.push_back(Index_);
+      std::push_heap(free_indices.begin(), free_indices.end(), 
+        std::greater<unsigned>());
+    }
+
+    unsigned Index_;
+  };
+  thread_local ThreadIndex thread_index;
+
+  return readers[thread_index.Index_ & (reader_count - 1)];
+}
+
+/******************************************************************************
+ * @brief Helper function that adds a reader's probes to the calling thread's
+ *  slot
+ * 
+ * @tparam T 
+ * @param Probes 
+ *****************************************************************************/
+template<class T> void ConcurrentOAHashTable<T>::CountProbes(unsigned Probes)
+const
+{
+  ThreadSlot().Probes_.fetch_add(Probes, std::memory_order_relaxed);
+}
+
+/******************************************************************************
+ * @brief Helper function for a thread that holds a shard's lock 
+ *  exclusively. Flags the shard as being written, which sends new readers 
+ *  to the shared lock, then waits until no reader slot marks the shard. The 
+ *  caller clears the flag when it is done. Costs one load per reader slot.
+ * 
+ * @tparam T 
+ * @param S 
+ *****************************************************************************/
+template<class T> void ConcurrentOAHashTable<T>::ExcludeReaders(Shard &S) 
+const
+{
+  unsigned mark = static_cast<unsigned>(&S - shards) + 1;
+
+  S.writing.store(true);
+  for (unsigned i = 0; i < reader_count; ++i)
+  {
+    while (readers[i].Shard_.load() == mark)
+    {
+      std::this_thread::yield();
+    }
+  }
+}
+
+/******************************************************************************
+ * @brief Helper function that frees every shard and reader slot
+ * 
+ * @tparam T 
+ *****************************************************************************/
+template<class T> void ConcurrentOAHashTable<T>::Release()
+{
+  if (shards)
+  {
+    for (unsigned i = 0; i < shard_count; ++i)
+    {
+      delete shards[i].table;
+    }
+  }
+  delete [] shards;
+  delete [] readers;
+  shards = 0;
+  readers = 0;
+}
+
+/******************************************************************************
+ * @brief Helper function that rounds Value up to a power of two
+ * 
+ * @tparam T 
+ * @param Value 
+ * @return unsigned 
+ *****************************************************************************/
+template<class T> unsigned ConcurrentOAHashTable<T>::NextPowerOfTwo(
+  unsigned Value)
+{
+  unsigned result = 1;
+  while (result < Value)
+  {
+    result <<= 1;
+  }
+  return result;
+}
@@ -0,0 +1,376 @@
+/******************************************************************************
+ * @file ConcurrentOAHashTable_bench.cpp
+ * @author Jay Sharma
+ * @brief Read/write mix benchmark for ConcurrentOAHashTable. Runs finds,
+ *  inserts and removes from a growing number of threads, with uniform and
+ *  Zipfian key popularity, and compares against a std::unordered_map behind
+ *  a single std::shared_mutex. Prints one CSV row per run.
+ * 
+ *  Usage: ConcurrentOAHashTable_bench [keys] [ops per thread] [max threads]
+ * @version 0.1
+ * @date 2026-10-16
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ *****************************************************************************/
+
+#include "ConcurrentOAHashTable.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Zipf exponent for the skewed runs
+static const double ZIPF_SKEW = 0.99;
+
+// Percentage of operations that are finds, for each mix
+static const unsigned READ_MIXES[] = {100, 95, 50};
+
+// One operation of a run: which key, and what to do with it
+struct BenchOp
+{
+  unsigned Key_;
+  enum BenchOpType {FIND, INSERT, REMOVE} Type_;
+};
+
+/******************************************************************************
+ * @brief FNV-1a, used as the primary hash function of every shard
+ * 
+ * @param Key 
+ * @param TableSize 
+ * @return unsigned 
+ *****************************************************************************/
+static unsigned FNVHash(const char *Key, unsigned TableSize)
+{
+  unsigned hash = 2166136261u;
+  for (; *Key; ++Key)
+  {
+    hash = (hash ^ static_cast<unsigned char>(*Key)) * 16777619u;
+  }
+  return hash % TableSize;
+}
+
+/******************************************************************************
+ * @brief Makes Count distinct keys. They share a long prefix on purpose,
+ *  which is what a table that only hashes the first few bytes gets wrong.
+ * 
+ * @param Count 
+ * @return std::vector<std::string> 
+ *****************************************************************************/
+static std::vector<std::string> MakeKeys(unsigned Count)
+{
+  std::vector<std::string> keys(Count);
+  for (unsigned i = 0; i < Count; ++i)
+  {
+    keys[i] = "session/" + std::to_string(i * 2654435761u);
+  }
+  return keys;
+}
+
+/******************************************************************************
+ * @brief Draws key indices in [0, Count), either uniformly or with Zipfian
+ *  popularity (rank r has weight 1 / r^ZIPF_SKEW)
+ *****************************************************************************/
+class KeyPicker
+{
+  public:
+    KeyPicker(unsigned Count, bool Zipf) : count(Count), zipf(Zipf)
+    {
+      if (zipf)
+      {
+        cdf.resize(count);
+        double sum = 0.0;
+        for (unsigned i = 0; i < count; ++i)
+        {
+          sum += 1.0 / std::pow(i + 1.0, ZIPF_SKEW);
+          cdf[i] = sum;
+        }
+        for (double& c : cdf)
+        {
+          c /= sum;
+        }
+      }
+    }
+
+    unsigned operator()(std::mt19937 &Rng) const
+    {
+      if (!zipf)
+      {
+        return Rng() % count;
+      }
+
+      double u = std::uniform_real_distribution<double>(0.0, 1.0)(Rng);
+      unsigned rank = static_cast<unsigned>(
+        std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin());
+      return rank < count ? rank : count - 1;
+    }
+
+  private:
+    unsigned count;
+    bool zipf;
+    std::vector<double> cdf;
+};
+
+/******************************************************************************
+ * @brief Builds each thread's operations up front, so random number
+ *  generation is not timed. Finds may hit any key. Each thread writes only
+ *  the keys whose index is its own modulo Threads and tracks which of them
+ *  are present, so every insert adds a key and every remove takes one away;
+ *  no write fails, and the table stays near its starting size.
+ * 
+ * @param Threads 
+ * @param Ops 
+ * @param ReadPercent 
+ * @param Picker 
+ * @param Count  // number of keys; the even ones start out present 
+ * @return std::vector<std::vector<BenchOp>> 
+ *****************************************************************************/
+static std::vector<std::vector<BenchOp>> MakeOps(unsigned Threads,
+  unsigned Ops, unsigned ReadPercent, const KeyPicker &Picker, unsigned Count)
+{
+  std::vector<std::vector<BenchOp>> ops(Threads);
+  for (unsigned t = 0; t < Threads; ++t)
+  {
+    std::mt19937 rng(t * 7919 + ReadPercent);
+    std::vector<bool> present(Count);
+    for (unsigned i = 0; i < Count; i += 2)
+    {
+      present[i] = true;
+    }
+
+    ops[t].resize(Ops);
+    for (BenchOp& op : ops[t])
+    {
+      op.Key_ = Picker(rng);
+      if (rng() % 100 < ReadPercent)
+      {
+        op.Type_ = BenchOp::FIND;
+        continue;
+      }
+
+      // Move to the nearest key this thread owns
+      op.Key_ = op.Key_ - op.Key_ % Threads + t;
+      if (op.Key_ >= Count)
+      {
+        op.Key_ = t;
+      }
+      op.Type_ = present[op.Key_] ? BenchOp::REMOVE : BenchOp::INSERT;
+      present[op.Key_] = !present[op.Key_];
+    }
+  }
+  return ops;
+}
+
+/******************************************************************************
+ * @brief Runs Body(t) on Threads threads, started together, and returns the
+ *  wall time in seconds
+ * 
+ * @tparam F 
+ * @param Threads 
+ * @param Body 
+ * @return double 
+ *****************************************************************************/
+template<class F> static double TimeThreads(unsigned Threads, const F &Body)
+{
+  std::atomic<unsigned> ready(0);
+  std::atomic<bool> go(false);
+  std::vector<std::thread> workers;
+
+  for (unsigned t = 0; t < Threads; ++t)
+  {
+    workers.emplace_back([&, t]()
+    {
+      ready.fetch_add(1);
+      while (!go.load())
+      {
+        std::this_thread::yield();
+      }
+      Body(t);
+    });
+  }
+
+  while (ready.load() != Threads)
+  {
+    std::this_thread::yield();
+  }
+  auto start = std::chrono::steady_clock::now();
+  go.store(true);
+  for (std::thread& worker : workers)
+  {
+    worker.join();
+  }
+  return std::chrono::duration<double>(
+    std::chrono::steady_clock::now() - start).count();
+}
+
+/******************************************************************************
+ * @brief Times one mix against ConcurrentOAHashTable. Finds use try_find,
+ *  so a miss costs the same as it does in the baseline.
+ * 
+ * @param Keys 
+ * @param Ops 
+ * @return double // seconds 
+ *****************************************************************************/
+static double RunSharded(const std::vector<std::string> &Keys,
+  const std::vector<std::vector<BenchOp>> &Ops)
+{
+  OAHashTable<unsigned>::OAHTConfig config(
+    static_cast<unsigned>(Keys.size()) * 2, FNVHash);
+  config.ArenaKeys_ = true;
+  config.ControlBytes_ = true;
+  config.StoreHash_ = true;
+  ConcurrentOAHashTable<unsigned> table(config);
+
+  // Start with every other key present
+  for (unsigned i = 0; i < Keys.size(); i += 2)
+  {
+    table.insert(Keys[i].c_str(), i);
+  }
+
+  std::atomic<unsigned long long> checksum(0);
+  double seconds = TimeThreads(static_cast<unsigned>(Ops.size()),
+    [&](unsigned Thread)
+  {
+    unsigned long long sum = 0;
+    for (const BenchOp& op : Ops[Thread])
+    {
+      const char *key = Keys[op.Key_].c_str();
+      if (op.Type_ == BenchOp::FIND)
+      {
+        unsigned data = 0;
+        table.try_find(key, data);
+        sum += data;
+      }
+      else if (op.Type_ == BenchOp::INSERT)
+      {
+        table.insert(key, op.Key_);
+      }
+      else
+      {
+        table.remove(key);
+      }
+    }
+    checksum.fetch_add(sum);
+  });
+
+  return seconds;
+}
+
+/******************************************************************************
+ * @brief Times one mix against a std::unordered_map behind one
+ *  std::shared_mutex, the usual starting point this table replaces
+ * 
+ * @param Keys 
+ * @param Ops 
+ * @return double // seconds 
+ *****************************************************************************/
+static double RunBaseline(const std::vector<std::string> &Keys,
+  const std::vector<std::vector<BenchOp>> &Ops)
+{
+  std::unordered_map<std::string, unsigned> table(Keys.size() * 2);
+  std::shared_mutex lock;
+
+  for (unsigned i = 0; i < Keys.size(); i += 2)
+  {
+    table.emplace(Keys[i], i);
+  }
+
+  std::atomic<unsigned long long> checksum(0);
+  double seconds = TimeThreads(static_cast<unsigned>(Ops.size()),
+    [&](unsigned Thread)
+  {
+    unsigned long long sum = 0;
+    for (const BenchOp& op : Ops[Thread])
+    {
+      const std::string& key = Keys[op.Key_];
+      if (op.Type_ == BenchOp::FIND)
+      {
+        std::shared_lock<std::shared_mutex> reader(lock);
+        auto it = table.find(key);
+        sum += it == table.end() ? 0 : it->second;
+      }
+      else if (op.Type_ == BenchOp::INSERT)
+      {
+        std::unique_lock<std::shared_mutex> writer(lock);
+        table.emplace(key, op.Key_);
+      }
+      else
+      {
+        std::unique_lock<std::shared_mutex> writer(lock);
+        table.erase(key);
+      }
+    }
+    checksum.fetch_add(sum);
+  });
+
+  return seconds;
+}
+
+/******************************************************************************
+ * @brief Sweeps read mixes, key distributions and thread counts (powers of
+ *  two up to the maximum) and prints throughput in millions of operations
+ *  per second, plus the speedup over one thread of the same table
+ * 
+ * @param argc 
+ * @param argv 
+ * @return int 
+ *****************************************************************************/
+int main(int argc, char *argv[])
+{
+  unsigned key_count = argc > 1 ? std::atoi(argv[1]) : 1u << 20;
+  unsigned ops = argc > 2 ? std::atoi(argv[2]) : 1u << 20;
+  unsigned max_threads = argc > 3 ? std::atoi(argv[3])
+                                  : std::thread::hardware_concurrency();
+  if (max_threads == 0)
+  {
+    max_threads = 1;
+  }
+
+  std::vector<std::string> keys = MakeKeys(key_count);
+  std::printf("table,keys,read_pct,threads,mops,speedup\n");
+
+  for (bool zipf : {false, true})
+  {
+    KeyPicker picker(key_count, zipf);
+    for (unsigned read : READ_MIXES)
+    {
+      double sharded_one = 0.0;
+      double baseline_one = 0.0;
+      for (unsigned threads = 1; threads <= max_threads; threads *= 2)
+      {
+        std::vector<std::vector<BenchOp>> mix =
+          MakeOps(threads, ops, read, picker, key_count);
+        double total = static_cast<double>(threads) * ops / 1e6;
+
+        double sharded = total / RunSharded(keys, mix);
+        double baseline = total / RunBaseline(keys, mix);
+        if (threads == 1)
+        {
+          sharded_one = sharded;
+          baseline_one = baseline;
+        }
+
+        std::printf("sharded,%s,%u,%u,%.2f,%.2f\n", zipf ? "zipf" : "uniform",
+          read, threads, sharded, sharded / sharded_one);
+        std::printf("unordered_map,%s,%u,%u,%.2f,%.2f\n",
+          zipf ? "zipf" : "uniform", read, threads, baseline,
+          baseline / baseline_one);
+
+        if (threads < max_threads && threads * 2 > max_threads)
+        {
+          threads = max_threads / 2;
+        }
+      }
+    }
+  }
+
+  return 0;
+}
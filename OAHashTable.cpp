@@ -12,365 +12,3620 @@
 
 #include "OAHashTable.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || \
+  (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define OAHT_SSE2
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+static inline int __builtin_ctz(unsigned x) {
+  unsigned long res;
+  _BitScanForward(&res, x);
+  return (int)res;
+}
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cstdio>
+#include <exception>
+#include <new>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+// Control byte encoding: full slots hold a 7-bit fingerprint (high bit clear)
+static const unsigned char CTRL_EMPTY   = 0x80;
+static const unsigned char CTRL_DELETED = 0xFE;
+
+// Number of control bytes examined per group probe
+static const unsigned GROUP_WIDTH = 16;
+
+// Returned by the index helpers when a key is not in the table
+static const unsigned OAHT_NPOS = static_cast<unsigned>(-1);
+
+// Returned by the insert index helpers when the key is already in the table
+static const unsigned OAHT_DUPLICATE = static_cast<unsigned>(-2);
+
+// Number of keys hashed and prefetched together by the batch operations
+static const unsigned OAHT_BATCH = 16;
+
+// Fewest keys per thread worth starting a thread for in bulk_insert
+static const unsigned OAHT_BULK_MIN = 4096;
+
+// Range passed to the primary hash function when slots store the full hash
+// (largest 32-bit prime, so "hash % TableSize" style functions keep mixing)
+static const unsigned OAHT_HASH_RANGE = 4294967291u;
+
+// Snapshot files are tagged with a magic string and a format version. Bump 
+// the version whenever the header or slot layout changes.
+static const char OAHT_SNAPSHOT_MAGIC[8] = {'O','A','H','T','S','N','A','P'};
+static const unsigned OAHT_SNAPSHOT_VERSION = 3;
+
+// Snapshot flags for the config options that change the stored layout
+static const unsigned OAHT_SNAPSHOT_CTRL      = 1;
+static const unsigned OAHT_SNAPSHOT_HASH      = 2;
+static const unsigned OAHT_SNAPSHOT_ARENA     = 4;
+static const unsigned OAHT_SNAPSHOT_SECONDARY = 8;
+static const unsigned OAHT_SNAPSHOT_COMPACT   = 16;
+
+// Key passed to the hash functions to check that a snapshot is opened with 
+// the same ones it was saved with
+static const char OAHT_SNAPSHOT_PROBE_KEY[] = "snapshot";
+
+// Header at the start of a snapshot file. The slot array, control bytes and 
+// arena keys follow at the recorded offsets, exactly as they sit in memory.
+struct OAHTSnapshotHeader
+{
+  char Magic_[8];
+  unsigned Version_;
+  unsigned SlotSize_;
+  unsigned DataSize_;
+  unsigned Flags_;
+  unsigned DeletionPolicy_;
+  unsigned CapacityPolicy_;
+  unsigned HashCheck_;
+  unsigned TableSize_;
+  unsigned Count_;
+  unsigned Probes_;
+  unsigned Expansions_;
+  unsigned Compactions_;
+  unsigned Tombstones_;
+  unsigned ProbeHistogram_[OAHT_HISTOGRAM_BUCKETS];
+  unsigned ArenaGarbage_;
+  unsigned long long SlotsOffset_;
+  unsigned long long CtrlOffset_;
+  unsigned long long KeysOffset_;
+  unsigned long long KeysSize_;
+  unsigned long long FileSize_;
+};
+
+/******************************************************************************
+ * @brief FNV-1a over the part of the key that is actually stored (Length 
+ *  bytes). Used to derive control byte fingerprints when the slots do not 
+ *  store the primary hash, so it never has to agree with the user's hash 
+ *  functions.
+ * 
+ * @param Key 
+ * @param Length 
+ * @return unsigned 
+ *****************************************************************************/
+static inline unsigned OAHTKeyHash(const char *Key, unsigned Length)
+{
+  unsigned hash = 2166136261u;
+  for (unsigned i = 0; i < Length; ++i)
+  {
+    hash = (hash ^ static_cast<unsigned char>(Key[i])) * 16777619u;
+  }
+  return hash;
+}
+
+/******************************************************************************
+ * @brief 7-bit fingerprint stored in the control byte of a full slot. The 
+ *  multiply spreads weak hashes into the top bits before they are taken.
+ * 
+ * @param Hash 
+ * @return unsigned char 
+ *****************************************************************************/
+static inline unsigned char OAHTFingerprint(unsigned Hash)
+{
+  return static_cast<unsigned char>((Hash * 2654435769u) >> 25);
+}
+
+/******************************************************************************
+ * @brief Advances a probe index by Step (which must be less than Size) 
+ *  without a division
+ * 
+ * @param Index 
+ * @param Step 
+ * @param Size 
+ * @return unsigned 
+ *****************************************************************************/
+static inline unsigned OAHTAdvance(unsigned Index, unsigned Step, 
+  unsigned Size)
+{
+  Index += Step;
+  return Index >= Size ? Index - Size : Index;
+}
+
+/******************************************************************************
+ * @brief Finalizer from MurmurHash3. Every input bit affects every output 
+ *  bit, so masking off the low bits of the result is safe even for weak 
+ *  user hash functions.
+ * 
+ * @param Hash 
+ * @return unsigned 
+ *****************************************************************************/
+static inline unsigned OAHTMix(unsigned Hash)
+{
+  Hash ^= Hash >> 16;
+  Hash *= 0x85EBCA6Bu;
+  Hash ^= Hash >> 13;
+  Hash *= 0xC2B2AE35u;
+  Hash ^= Hash >> 16;
+  return Hash;
+}
+
+/******************************************************************************
+ * @brief Rounds Value up to a power of two (at least 2)
+ * 
+ * @param Value 
+ * @return unsigned 
+ *****************************************************************************/
+static inline unsigned OAHTPowerOfTwo(unsigned Value)
+{
+  unsigned result = 2;
+  while (result < Value)
+  {
+    result <<= 1;
+  }
+  return result;
+}
+
+/******************************************************************************
+ * @brief Hints the CPU to start loading the cache line at Address
+ * 
+ * @param Address 
+ *****************************************************************************/
+static inline void OAHTPrefetch(const void *Address)
+{
+#ifdef _MSC_VER
+  _mm_prefetch(static_cast<const char*>(Address), _MM_HINT_T0);
+#else
+  __builtin_prefetch(Address);
+#endif
+}
+
+/******************************************************************************
+ * @brief Returns a bitmask with bit i set if Group[i] == Value, for the
+ *  GROUP_WIDTH bytes starting at Group.
+ * 
+ * @param Group 
+ * @param Value 
+ * @return unsigned 
+ *****************************************************************************/
+static inline unsigned OAHTMatchByte(const unsigned char *Group, 
+  unsigned char Value)
+{
+#ifdef OAHT_SSE2
+  __m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Group));
+  __m128i match = _mm_set1_epi8(static_cast<char>(Value));
+  return static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, match)));
+#else
+  unsigned mask = 0;
+  for (unsigned i = 0; i < GROUP_WIDTH; ++i)
+  {
+    mask |= static_cast<unsigned>(Group[i] == Value) << i;
+  }
+  return mask;
+#endif
+}
+
+/******************************************************************************
+ * @brief Returns a bitmask with bit i set if Group[i] is EMPTY or DELETED
+ *  (both encodings have the high bit set)
+ * 
+ * @param Group 
+ * @return unsigned 
+ *****************************************************************************/
+static inline unsigned OAHTMatchFree(const unsigned char *Group)
+{
+#ifdef OAHT_SSE2
+  __m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Group));
+  return static_cast<unsigned>(_mm_movemask_epi8(ctrl));
+#else
+  unsigned mask = 0;
+  for (unsigned i = 0; i < GROUP_WIDTH; ++i)
+  {
+    mask |= static_cast<unsigned>(Group[i] >> 7) << i;
+  }
+  return mask;
+#endif
+}
+
+/******************************************************************************
+ * @brief Returns the histogram bucket for an operation that took Probes 
+ *  probes. Bucket b counts 2^b to 2^(b+1) - 1 probes; the last bucket also 
+ *  takes everything longer.
+ * 
+ * @param Probes 
+ * @return unsigned 
+ *****************************************************************************/
+static inline unsigned OAHTProbeBucket(unsigned Probes)
+{
+  unsigned bucket = 0;
+  while (Probes > 1 && bucket < OAHT_HISTOGRAM_BUCKETS - 1)
+  {
+    Probes >>= 1;
+    ++bucket;
+  }
+  return bucket;
+}
+
+/******************************************************************************
+ * @brief Key accessors for the pairs given to bulk_insert
+ * 
+ * @param Key 
+ * @return const char* 
+ *****************************************************************************/
+static inline const char *OAHTKeyChars(const char *Key)
+{
+  return Key;
+}
+
+static inline const char *OAHTKeyChars(const std::string &Key)
+{
+  return Key.c_str();
+}
+
+/******************************************************************************
+ * @brief Runs Body(0) to Body(Threads - 1), each on its own thread (the 
+ *  calling thread takes Body(0)). If a thread cannot be started its part 
+ *  runs on the calling thread instead. Returns the first exception thrown 
+ *  by any part, or null, once they have all finished.
+ * 
+ * @tparam F 
+ * @param Threads 
+ * @param Body 
+ * @return std::exception_ptr 
+ *****************************************************************************/
+template<class F> 
+static std::exception_ptr OAHTParallelFor(unsigned Threads, const F &Body)
+{
+  std::vector<std::exception_ptr> errors(Threads);
+  std::vector<std::thread> workers;
+  workers.reserve(Threads);
+
+  auto run = [&](unsigned Part)
+  {
+    try
+    {
+      Body(Part);
+    }
+    catch(...)
+    {
+      errors[Part] = std::current_exception();
+    }
+  };
+
+  for (unsigned i = 1; i < Threads; ++i)
+  {
+    try
+    {
+      workers.emplace_back(run, i);
+    }
+    catch(const std::system_error&)
+    {
+      run(i);
+    }
+  }
+  run(0);
+
+  for (std::thread& worker : workers)
+  {
+    worker.join();
+  }
+  for (const std::exception_ptr& error : errors)
+  {
+    if (error)
+    {
+      return error;
+    }
+  }
+  return 0;
+}
+
+/******************************************************************************
+ * @brief 64x64 -> 128-bit multiply folded back to 64 bits (high ^ low). The 
+ *  mixing step of the built-in string hash.
+ * 
+ * @param A 
+ * @param B 
+ * @return unsigned long long 
+ *****************************************************************************/
+static inline unsigned long long OAHTMum(unsigned long long A, 
+  unsigned long long B)
+{
+#if defined(__SIZEOF_INT128__)
+  unsigned __int128 product = static_cast<unsigned __int128>(A) * B;
+  return static_cast<unsigned long long>(product) ^ 
+         static_cast<unsigned long long>(product >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+  unsigned long long high;
+  unsigned long long low = _umul128(A, B, &high);
+  return low ^ high;
+#else
+  unsigned long long a_lo = A & 0xFFFFFFFFull, a_hi = A >> 32;
+  unsigned long long b_lo = B & 0xFFFFFFFFull, b_hi = B >> 32;
+  unsigned long long lo_lo = a_lo * b_lo, hi_lo = a_hi * b_lo;
+  unsigned long long lo_hi = a_lo * b_hi, hi_hi = a_hi * b_hi;
+  unsigned long long cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFFull) + lo_hi;
+  unsigned long long high = hi_hi + (hi_lo >> 32) + (cross >> 32);
+  unsigned long long low = (cross << 32) | (lo_lo & 0xFFFFFFFFull);
+  return low ^ high;
+#endif
+}
+
+/******************************************************************************
+ * @brief Reads Count (at most 8) bytes into a 64-bit word, padding the rest 
+ *  with zeros. Bytes are copied, so the read never goes past the end of the 
+ *  key.
+ * 
+ * @param Bytes 
+ * @param Count 
+ * @return unsigned long long 
+ *****************************************************************************/
+static inline unsigned long long OAHTReadWord(const char *Bytes, 
+  size_t Count)
+{
+  unsigned long long word = 0;
+  memcpy(&word, Bytes, Count);
+  return word;
+}
+
+/******************************************************************************
+ * @brief Strong 64-bit integer mixer (the MurmurHash3 / SplitMix64 
+ *  finalizer). Every input bit affects every output bit.
+ * 
+ * @param Value 
+ * @return unsigned long long 
+ *****************************************************************************/
+static inline unsigned long long OAHTMix64(unsigned long long Value)
+{
+  Value ^= Value >> 33;
+  Value *= 0xFF51AFD7ED558CCDull;
+  Value ^= Value >> 33;
+  Value *= 0xC4CEB9FE1A85EC53ull;
+  Value ^= Value >> 33;
+  return Value;
+}
+
+/******************************************************************************
+ * @brief Maps a 32-bit hash onto [0, Size) with a multiply and shift 
+ *  instead of a division
+ * 
+ * @param Hash 
+ * @param Size 
+ * @return unsigned 
+ *****************************************************************************/
+static inline unsigned OAHTReduce(unsigned Hash, unsigned Size)
+{
+  return static_cast<unsigned>(
+    (static_cast<unsigned long long>(Hash) * Size) >> 32);
+}
+
+/******************************************************************************
+ * @brief Hash policy that calls the function pointers from OAHTConfig. The 
+ *  default, so existing code keeps working unchanged. The functions take C 
+ *  strings, so Length is ignored and keys that are not null-terminated are 
+ *  copied before they get here (see NeedsCString). The only policy with 
+ *  DoubleHashing: it double hashes when SecondaryHashFunc_ is set.
+ * 
+ * @param Primary 
+ * @param Secondary 
+ *****************************************************************************/
+inline OAHTFunctionHash::OAHTFunctionHash(HASHFUNC Primary, 
+  HASHFUNC Secondary)
+: primary(Primary), secondary(Secondary)
+{
+}
+
+inline unsigned OAHTFunctionHash::Primary(const char *Key, unsigned, 
+  unsigned Size) const
+{
+  return primary(Key, Size);
+}
+
+inline unsigned OAHTFunctionHash::Secondary(const char *Key, unsigned, 
+  unsigned Size) const
+{
+  return secondary(Key, Size);
+}
+
+inline bool OAHTFunctionHash::HasSecondary() const
+{
+  return secondary != 0;
+}
+
+/******************************************************************************
+ * @brief Built-in hash policy for C string keys, in the style of wyhash: the 
+ *  key is read 8 bytes at a time and each pair of words is mixed with one 
+ *  wide multiply. The whole hash inlines into the probe. Only the first 
+ *  Length bytes are read, so keys need not be null-terminated. The config's 
+ *  primary hash function is ignored. There is no double hashing 
+ *  (DoubleHashing is false): the table probes linearly, and a config that 
+ *  sets SecondaryHashFunc_ is rejected.
+ * 
+ * @param Primary 
+ * @param Secondary 
+ *****************************************************************************/
+inline OAHTStringHash::OAHTStringHash(HASHFUNC, HASHFUNC)
+{
+}
+
+inline unsigned OAHTStringHash::Primary(const char *Key, unsigned Length, 
+  unsigned Size) const
+{
+  return OAHTReduce(Hash(Key, Length), Size);
+}
+
+inline bool OAHTStringHash::HasSecondary() const
+{
+  return false;
+}
+
+inline unsigned OAHTStringHash::Hash(const char *Key)
+{
+  return Hash(Key, static_cast<unsigned>(strlen(Key)));
+}
+
+inline unsigned OAHTStringHash::Hash(const char *Key, unsigned Length)
+{
+  static const unsigned long long P0 = 0xA0761D6478BD642Full;
+  static const unsigned long long P1 = 0xE7037ED1A0B428DBull;
+  static const unsigned long long P2 = 0x8EBC6AF09C88C6E3ull;
+
+  size_t length = Length;
+  unsigned long long seed = P0 ^ length;
+  unsigned long long a, b;
+
+  // Short keys (the common case) are covered by a few overlapping reads
+  if (length <= 16)
+  {
+    if (length >= 4)
+    {
+      size_t shift = (length >> 3) << 2;
+      a = OAHTReadWord(Key, 4) << 32 | OAHTReadWord(Key + shift, 4);
+      b = OAHTReadWord(Key + length - 4, 4) << 32 | 
+          OAHTReadWord(Key + length - 4 - shift, 4);
+    }
+    else if (length > 0)
+    {
+      const unsigned char *bytes = reinterpret_cast<const unsigned char*>(Key);
+      a = static_cast<unsigned long long>(bytes[0]) << 16 | 
+          static_cast<unsigned long long>(bytes[length >> 1]) << 8 | 
+          bytes[length - 1];
+      b = 0;
+    }
+    else
+    {
+      a = b = 0;
+    }
+  }
+  else
+  {
+    size_t left = length;
+    const char *block = Key;
+    for (; left > 16; left -= 16, block += 16)
+    {
+      seed = OAHTMum(OAHTReadWord(block, 8) ^ P1, 
+                     OAHTReadWord(block + 8, 8) ^ seed);
+    }
+
+    // The last 16 bytes, overlapping the final block if need be
+    a = OAHTReadWord(Key + length - 16, 8);
+    b = OAHTReadWord(Key + length - 8, 8);
+  }
+
+  unsigned long long hash = OAHTMum(P2 ^ length, OAHTMum(a ^ P1, b ^ seed));
+  return static_cast<unsigned>(hash ^ (hash >> 32));
+}
+
+/******************************************************************************
+ * @brief Built-in hash policy for keys that are decimal integers (IDs and 
+ *  the like). The digits are parsed into a 64-bit value, which goes through 
+ *  OAHTMix64, so sequential IDs still spread across the table. Keys with 
+ *  anything other than an optional leading '-' and digits fall back to 
+ *  OAHTStringHash. Like OAHTStringHash it probes linearly and rejects a 
+ *  SecondaryHashFunc_.
+ * 
+ * @param Primary 
+ * @param Secondary 
+ *****************************************************************************/
+inline OAHTIntegerHash::OAHTIntegerHash(HASHFUNC, HASHFUNC)
+{
+}
+
+inline unsigned OAHTIntegerHash::Primary(const char *Key, unsigned Length, 
+  unsigned Size) const
+{
+  return OAHTReduce(Hash(Key, Length), Size);
+}
+
+inline bool OAHTIntegerHash::HasSecondary() const
+{
+  return false;
+}
+
+inline unsigned OAHTIntegerHash::Hash(const char *Key)
+{
+  return Hash(Key, static_cast<unsigned>(strlen(Key)));
+}
+
+inline unsigned OAHTIntegerHash::Hash(const char *Key, unsigned Length)
+{
+  bool negative = Length && *Key == '-';
+  const char *digit = Key + negative;
+  const char *end = Key + Length;
+  unsigned long long value = 0;
+  for (; digit != end && *digit >= '0' && *digit <= '9'; ++digit)
+  {
+    value = value * 10 + static_cast<unsigned long long>(*digit - '0');
+  }
+
+  // Not a plain integer, or too long to be one
+  if (digit != end || digit == Key + negative || Length > 20)
+  {
+    return OAHTStringHash::Hash(Key, Length);
+  }
+
+  unsigned long long hash = OAHTMix64(negative ? ~value : value);
+  return static_cast<unsigned>(hash ^ (hash >> 32));
+}
+
+/******************************************************************************
+ * @brief Construct a new OAHashTable<T, H, K>::OAHashTable object. The hash 
+ * policy H is built from the config's hash function pointers; the built-in 
+ * policies ignore the primary one and do not double hash, so they throw if 
+ * given a secondary one. With the OAHTArenaKeys key policy K the slots have 
+ * no key array at all, so ArenaKeys_ and StoreHash_ are always on. 
+ * (E_BAD_CONFIG, E_NO_MEMORY)
+ * 
+ * @tparam T 
+ * @tparam H 
+ * @tparam K 
+ * @param Config 
+ *****************************************************************************/
+template<class T, class H, class K> OAHashTable<T, H, K>::
+OAHashTable(const OAHashTable<T, H, K>::OAHTConfig &Config)
+: config(Config), hasher(Config.PrimaryHashFunc_, Config.SecondaryHashFunc_)
+{
+  // A secondary hash would be silently ignored
+  if (!H::DoubleHashing && config.SecondaryHashFunc_)
+  {
+    throw (OAHashTableException(OAHashTableException::E_BAD_CONFIG,
+      "The hash policy does not support a secondary hash function"));
+  }
+
+  // Compact slots only hold the key's offset, length and hash
+  if (K::Arena)
+  {
+    config.ArenaKeys_ = true;
+    config.StoreHash_ = true;
+  }
+
+  // Power-of-two tables take their home slots from the full (mixed) hash
+  if (config.CapacityPolicy_ == OAHTCapacityPolicy::POWER_OF_TWO)
+  {
+    config.InitialTableSize_ = OAHTPowerOfTwo(config.InitialTableSize_);
+    config.StoreHash_ = true;
+  }
+
+  try
+  {
+    table = 0;
+    ctrl = 0;
+    grow_table = 0;
+    grow_ctrl = 0;
+    migrate_table = 0;
+    arena_garbage = 0;
+    mapping = 0;
+    mapping_size = 0;
+    mapped_keys = 0;
+    mapped_keys_size = 0;
+
+    // Make the initial table
+    table = AllocSlots(config.InitialTableSize_);
+
+    // Control bytes are mirrored past the end so a group never wraps
+    if (config.ControlBytes_)
+    {
+      ctrl = new unsigned char[config.InitialTableSize_ + GROUP_WIDTH - 1];
+    }
+  }
+  catch(const std::bad_alloc&)
+  {
+    FreeSlots(table, 0);
+    throw (OAHashTableException(OAHashTableException::E_NO_MEMORY,
+      "The table does not have enough memory"));
+  }
+
+  InitTable();
+  UpdateMemory(0);
+}
+
+/******************************************************************************
+ * @brief Construct a new OAHashTable<T> object filled from the Key/Data 
+ *  pairs in [First, Last) with bulk_insert. Later duplicates of a key are 
+ *  dropped; use bulk_insert on an empty table to get their count.
+ * 
+ * @tparam T 
+ * @tparam It 
+ * @param Config 
+ * @param First 
+ * @param Last 
+ * @param Threads 
+ *****************************************************************************/
+template<class T, class H, class K> template<class It> OAHashTable<T, H, K>::
+OAHashTable(const OAHTConfig &Config, It First, It Last, unsigned Threads)
+: OAHashTable(Config)
+{
+  bulk_insert(First, Last, Threads);
+}
+
+/******************************************************************************
+ * @brief Destroy the OAHashTable<T, H, K>::OAHashTable object
+ * 
+ * @tparam T 
+ *****************************************************************************/
+template<class T, class H, class K> OAHashTable<T, H, K>::~OAHashTable()
+{
+  // A loaded snapshot owns no slots of its own
+  if (mapping)
+  {
+    Unmap();
+    return;
+  }
+
+  // Clear the table
+  clear();
+
+  // Delete the table
+  FreeSlots(table, stats.TableSize_);
+  delete [] ctrl;
+}
+
+/******************************************************************************
+ * @brief Inserts a Key/Data pair into the table. Throws an exception if the 
+ * data cannot be inserted. (E_DUPLICATE, E_NO_MEMORY)
+ * 
+ * @tparam T 
+ * @param Key 
+ * @param Data 
+ *****************************************************************************/
+template<class T, class H, class K> void 
+OAHashTable<T, H, K>::insert(const char *Key, const T &Data)
+{
+  if (!try_insert(Key, Data))
+  {
+    throw (OAHashTableException(OAHashTableException::E_DUPLICATE,
+    "Item being inserted is a duplicate"));
+  }
+}
+
+/******************************************************************************
+ * @brief Inserts a Key/Data pair into the table unless Key is already in it. 
+ * Returns false for a duplicate instead of throwing, and leaves the table 
+ * unchanged. Throws an exception if the table cannot grow. (E_NO_MEMORY)
+ * 
+ * @tparam T 
+ * @param Key 
+ * @param Data 
+ * @return true 
+ * @return false 
+ *****************************************************************************/
+template<class T, class H, class K> bool 
+OAHashTable<T, H, K>::try_insert(const char *Key, 
+  const T &Data)
+{
+  PrepareInsert(1);
+
+  unsigned index = ClaimSlot(Key, HashKey(Key));
+  if (index == OAHT_DUPLICATE)
+  {
+    return false;
+  }
+
+  table[index].Data = Data;
+  return true;
+}
+
+/******************************************************************************
+ * @brief Move version of try_insert. Data is only moved from if the pair is 
+ * inserted. (E_NO_MEMORY)
+ * 
+ * @tparam T 
+ * @param Key 
+ * @param Data 
+ * @return true 
+ * @return false 
+ *****************************************************************************/
+template<class T, class H, class K> bool 
+OAHashTable<T, H, K>::try_insert(const char *Key, T &&Data)
+{
+  PrepareInsert(1);
+
+  unsigned index = ClaimSlot(Key, HashKey(Key));
+  if (index == OAHT_DUPLICATE)
+  {
+    return false;
+  }
+
+  table[index].Data = std::move(Data);
+  return true;
+}
+
+/******************************************************************************
+ * @brief Inserts Key with data built from Arguments unless Key is already in 
+ * the table. The data is built before a slot is claimed, so a constructor 
+ * that throws leaves the table unchanged. Slots always hold a live T, so 
+ * the new value is move-assigned into the slot rather than constructed in 
+ * it. Returns false for a duplicate. (E_NO_MEMORY)
+ * 
+ * @tparam T 
+ * @tparam Args 
+ * @param Key 
+ * @param Arguments 
+ * @return true 
+ * @return false 
+ *****************************************************************************/
+template<class T, class H, class K> template<class... Args> 
+bool OAHashTable<T, H, K>::emplace(const char *Key, Args&&... Arguments)
+{
+  // Build the data first; a claimed slot cannot be given back once a 
+  // Robin Hood insert has shifted its neighbours
+  T data(std::forward<Args>(Arguments)...);
+
+  PrepareInsert(1);
+
+  unsigned index = ClaimSlot(Key, HashKey(Key));
+  if (index == OAHT_DUPLICATE)
+  {
+    return false;
+  }
+
+  table[index].Data = std::move(data);
+  return true;
+}
+
+/******************************************************************************
+ * @brief Inserts a Key/Data pair into the table using a key that does not 
+ * have to be null-terminated. The built-in hash policies hash and compare 
+ * the key in place; only OAHTFunctionHash gets a null-terminated copy. Keys 
+ * longer than MAX_KEYLEN - 1 are only kept whole when ArenaKeys_ is set. 
+ * Throws an exception if the data cannot be inserted. 
+ * (E_DUPLICATE, E_NO_MEMORY)
+ * 
+ * @tparam T 
+ * @param Key 
+ * @param Data 
+ *****************************************************************************/
+template<class T, class H, class K> void 
+OAHashTable<T, H, K>::insert(std::string_view Key, 
+  const T &Data)
+{
+  // Only the user's hash functions need a C string
+  if constexpr (H::NeedsCString)
+  {
+    std::string key(Key);
+    insert(key.c_str(), Data);
+  }
+  else
+  {
+    PrepareInsert(1);
+
+    unsigned index = ClaimSlot(Key.data(), 
+      HashKey(Key.data(), static_cast<unsigned>(Key.size())));
+    if (index == OAHT_DUPLICATE)
+    {
+      throw (OAHashTableException(OAHashTableException::E_DUPLICATE,
+      "Item being inserted is a duplicate"));
+    }
+    table[index].Data = Data;
+  }
+}
+
+/******************************************************************************
+ * @brief Removes a Key/Data pair by key. Throws an exception if the pair 
+ * cannot be removed. (E_ITEM_NOT_FOUND)
+ * 
+ * @tparam T 
+ * @param Key 
+ *****************************************************************************/
+template<class T, class H, class K> void 
+OAHashTable<T, H, K>::remove(const char *Key)
+{
+  RemoveKey(Key, KeyLength(Key));
+}
+
+/******************************************************************************
+ * @brief Removes a Key/Data pair by a key that does not have to be 
+ * null-terminated. Throws an exception if the pair cannot be removed. 
+ * (E_ITEM_NOT_FOUND)
+ * 
+ * @tparam T 
+ * @param Key 
+ *****************************************************************************/
+template<class T, class H, class K> void 
+OAHashTable<T, H, K>::remove(std::string_view Key)
+{
+  // Only the user's hash functions need a C string
+  if constexpr (H::NeedsCString)
+  {
+    std::string key(Key);
+    remove(key.c_str());
+  }
+  else
+  {
+    RemoveKey(Key.data(), static_cast<unsigned>(Key.size()));
+  }
+}
+
+/******************************************************************************
+ * @brief Finds the data by key and returns a reference to the constant data. 
+ * Throws an exception if Key isn't found. (E_ITEM_NOT_FOUND)
+ * 
+ * @tparam T 
+ * @param Key 
+ * @return const T& 
+ *****************************************************************************/
+template<class T, class H, class K> const T& 
+OAHashTable<T, H, K>::find(const char *Key) const
+{
+  const T *data = try_find(Key);
+  if (!data)
+  {
+    throw(OAHashTableException(OAHashTableException::E_ITEM_NOT_FOUND,
+      "Item not found in table."));
+  }
+
+  return *data;
+}
+
+/******************************************************************************
+ * @brief Finds the data by key and returns a pointer to it, or null if Key 
+ * isn't found. Misses are cheap: nothing is thrown. The pointer is valid 
+ * until the table is next modified.
+ * 
+ * @tparam T 
+ * @param Key 
+ * @return const T* 
+ *****************************************************************************/
+template<class T, class H, class K> const T* 
+OAHashTable<T, H, K>::try_find(const char *Key) const
+{
+  return FindKey(Key, HashKey(Key));
+}
+
+/******************************************************************************
+ * @brief Finds the data by a key that does not have to be null-terminated. 
+ * Throws an exception if Key isn't found. (E_ITEM_NOT_FOUND)
+ * 
+ * @tparam T 
+ * @param Key 
+ * @return const T& 
+ *****************************************************************************/
+template<class T, class H, class K> const T& 
+OAHashTable<T, H, K>::find(std::string_view Key) const
+{
+  // Only the user's hash functions need a C string
+  if constexpr (H::NeedsCString)
+  {
+    std::string key(Key);
+    return find(key.c_str());
+  }
+  else
+  {
+    const T *data = FindKey(Key.data(), 
+      HashKey(Key.data(), static_cast<unsigned>(Key.size())));
+    if (!data)
+    {
+      throw(OAHashTableException(OAHashTableException::E_ITEM_NOT_FOUND,
+        "Item not found in table."));
+    }
+
+    return *data;
+  }
+}
+
+/******************************************************************************
+ * @brief Finds a batch of keys at once. Results[i] receives a pointer to the 
+ * data for Keys[i], or null if it isn't in the table. Keys are hashed and 
+ * their home slots prefetched a group at a time before any probing starts, 
+ * so the cache misses of the lookups in a group overlap.
+ * 
+ * @tparam T 
+ * @param Keys 
+ * @param Count 
+ * @param Results 
+ *****************************************************************************/
+template<class T, class H, class K> void 
+OAHashTable<T, H, K>::find_many(const char *const *Keys, 
+  unsigned Count, const T **Results) const
+{
+  OAHTKeyInfo info[OAHT_BATCH];
+  unsigned probes = 0;
+
+  for (unsigned first = 0; first < Count; first += OAHT_BATCH)
+  {
+    unsigned n = Count - first < OAHT_BATCH ? Count - first : OAHT_BATCH;
+
+    // Hash the whole group and start loading every home slot
+    for (unsigned i = 0; i < n; ++i)
+    {
+      info[i] = HashKey(Keys[first + i]);
+      PrefetchHome(info[i]);
+    }
+
+    // Then resolve the probes
+    for (unsigned i = 0; i < n; ++i)
+    {
+      unsigned start = probes;
+      Results[first + i] = LookupHashed(Keys[first + i], info[i], probes);
+      RecordProbeLength(probes - start);
+    }
+  }
+
+  stats.Probes_ += probes;
+}
+
+/******************************************************************************
+ * @brief Inserts a batch of Key/Data pairs. The table is grown once up front 
+ * for the whole batch, then keys are hashed and prefetched a group at a time 
+ * like find_many. Pairs are inserted in order; if one cannot be inserted an 
+ * exception is thrown and the pairs before it stay in the table. 
+ * (E_DUPLICATE, E_NO_MEMORY)
+ * 
+ * @tparam T 
+ * @param Keys 
+ * @param Data 
+ * @param Count 
+ *****************************************************************************/
+template<class T, class H, class K> void 
+OAHashTable<T, H, K>::insert_many(const char *const *Keys, 
+  const T *Data, unsigned Count)
+{
+  // Size the table for the whole batch so nothing moves while it is hashed
+  PrepareInsert(Count);
+
+  OAHTKeyInfo info[OAHT_BATCH];
+
+  for (unsigned first = 0; first < Count; first += OAHT_BATCH)
+  {
+    unsigned n = Count - first < OAHT_BATCH ? Count - first : OAHT_BATCH;
+
+    for (unsigned i = 0; i < n; ++i)
+    {
+      info[i] = HashKey(Keys[first + i]);
+      PrefetchHome(info[i]);
+    }
+
+    for (unsigned i = 0; i < n; ++i)
+    {
+      // Pay for part of an in-flight resize. If that swaps in the new 
+      // table, the rest of the group was hashed for the old size.
+      if (grow_table || migrate_table)
+      {
+        unsigned table_size = stats.TableSize_;
+        ResizeSome();
+        if (stats.TableSize_ != table_size)
+        {
+          for (unsigned j = i; j < n; ++j)
+          {
+            info[j] = HashKey(Keys[first + j]);
+          }
+        }
+      }
+
+      unsigned index = ClaimSlot(Keys[first + i], info[i]);
+      if (index == OAHT_DUPLICATE)
+      {
+        throw (OAHashTableException(OAHashTableException::E_DUPLICATE,
+        "Item being inserted is a duplicate"));
+      }
+      table[index].Data = Data[first + i];
+    }
+  }
+}
+
+/******************************************************************************
+ * @brief Inserts the Key/Data pairs in [First, Last), a random access range 
+ * whose elements have a first (const char * or std::string) and a second 
+ * (T), and returns how many were skipped as duplicates. The table is sized 
+ * once for the whole range. Keys are then hashed on Threads threads (zero 
+ * uses every core) and bucketed by which slice of the table their home 
+ * slot falls in, and each thread places the keys of its own slice. A key 
+ * whose probe sequence runs past the end of its slice is left for a 
+ * sequential pass at the end. Equal keys share a home slot, so they are 
+ * always handled by the same thread in input order: the first occurrence 
+ * wins no matter how many threads are used, and keys already in the table 
+ * keep their data. Robin Hood tables and double hashing are built one key 
+ * at a time. The hash functions must be safe to call from several threads. 
+ * (E_NO_MEMORY)
+ * 
+ * @tparam T 
+ * @tparam It 
+ * @param First 
+ * @param Last 
+ * @param Threads 
+ * @return unsigned 
+ *****************************************************************************/
+template<class T, class H, class K> template<class It> unsigned 
+OAHashTable<T, H, K>::bulk_insert(It First, It Last, unsigned Threads)
+{
+  unsigned count = static_cast<unsigned>(Last - First);
+  unsigned duplicates = 0;
+  if (count == 0)
+  {
+    return 0;
+  }
+
+  // Snapshots are copied out on the first write
+  if (mapping)
+  {
+    Promote();
+  }
+  ReserveTable(count);
+
+  if (Threads == 0)
+  {
+    Threads = std::thread::hardware_concurrency();
+  }
+  if (Threads > count / OAHT_BULK_MIN)
+  {
+    Threads = count / OAHT_BULK_MIN;
+  }
+
+  // Slices only work when every probe sequence is a run of adjacent slots 
+  // and entries never move once placed
+  if (Threads < 2 || hasher.HasSecondary() || 
+    config.DeletionPolicy_ == OAHTDeletionPolicy::ROBINHOOD)
+  {
+    for (unsigned i = 0; i < count; ++i)
+    {
+      const char *key = OAHTKeyChars(First[i].first);
+      unsigned index = ClaimSlot(key, HashKey(key));
+      if (index == OAHT_DUPLICATE)
+      {
+        ++duplicates;
+        continue;
+      }
+      table[index].Data = First[i].second;
+    }
+    return duplicates;
+  }
+
+  struct Slice
+  {
+    unsigned Probes_;
+    unsigned Count_;
+    unsigned Duplicates_;
+    unsigned Reused_;
+    unsigned Bytes_;
+    unsigned ProbeHistogram_[OAHT_HISTOGRAM_BUCKETS];
+    std::vector<unsigned> Spilled_;
+  };
+
+  std::vector<OAHTKeyInfo> info(count);
+  std::vector<unsigned> order(count);
+  std::vector<unsigned> offsets(config.ArenaKeys_ ? count : 0);
+  std::vector<unsigned> starts(Threads * Threads, 0);
+  std::vector<unsigned> bytes(Threads, 0);
+  std::vector<Slice> slices(Threads);
+  unsigned chunk = (count + Threads - 1) / Threads;
+  unsigned width = (stats.TableSize_ + Threads - 1) / Threads;
+
+  // Hash every key and count how many of each chunk land in each slice
+  std::exception_ptr error = OAHTParallelFor(Threads, [&](unsigned Part)
+  {
+    unsigned end = Part * chunk + chunk < count ? Part * chunk + chunk : count;
+    for (unsigned i = Part * chunk; i < end; ++i)
+    {
+      info[i] = HashKey(OAHTKeyChars(First[i].first));
+      ++starts[Part * Threads + info[i].Home / width];
+      bytes[Part] += info[i].Len + 1;
+    }
+  });
+  if (error)
+  {
+    std::rethrow_exception(error);
+  }
+
+  // Slices take consecutive runs of order, chunk by chunk, so each slice 
+  // sees its keys in input order. Each chunk's keys get consecutive room at 
+  // the end of the arena.
+  unsigned total = 0;
+  for (unsigned slice = 0; slice < Threads; ++slice)
+  {
+    for (unsigned part = 0; part < Threads; ++part)
+    {
+      unsigned n = starts[part * Threads + slice];
+      starts[part * Threads + slice] = total;
+      total += n;
+    }
+  }
+  unsigned bytes_start = static_cast<unsigned>(arena.size());
+  unsigned arena_end = bytes_start;
+  if (config.ArenaKeys_)
+  {
+    for (unsigned part = 0; part < Threads; ++part)
+    {
+      unsigned n = bytes[part];
+      bytes[part] = arena_end;
+      arena_end += n;
+    }
+    arena.resize(arena_end);
+    UpdateMemory(0);
+  }
+
+  OAHTParallelFor(Threads, [&](unsigned Part)
+  {
+    unsigned end = Part * chunk + chunk < count ? Part * chunk + chunk : count;
+    unsigned *next = &starts[Part * Threads];
+    for (unsigned i = Part * chunk; i < end; ++i)
+    {
+      order[next[info[i].Home / width]++] = i;
+      if (config.ArenaKeys_)
+      {
+        offsets[i] = bytes[Part];
+        bytes[Part] += info[i].Len + 1;
+      }
+    }
+  });
+
+  // Place each slice's keys. Threads only touch slots inside their slice.
+  error = OAHTParallelFor(Threads, [&](unsigned Part)
+  {
+    Slice& slice = slices[Part];
+    slice.Probes_ = slice.Count_ = slice.Duplicates_ = slice.Reused_ = 0;
+    slice.Bytes_ = 0;
+    memset(slice.ProbeHistogram_, 0, sizeof(slice.ProbeHistogram_));
+
+    unsigned end = Part * width + width < stats.TableSize_ ? 
+      Part * width + width : stats.TableSize_;
+    unsigned *ends = &starts[(Threads - 1) * Threads];
+    for (unsigned n = Part ? ends[Part - 1] : 0; n < ends[Part]; ++n)
+    {
+      unsigned i = order[n];
+      const char *key = OAHTKeyChars(First[i].first);
+      unsigned probes = 0;
+      unsigned index = RangeInsertIndex(key, info[i], end, probes);
+      slice.Probes_ += probes;
+      if (index == OAHT_NPOS)
+      {
+        slice.Spilled_.push_back(i);
+        continue;
+      }
+      ++slice.ProbeHistogram_[OAHTProbeBucket(probes)];
+      if (index == OAHT_DUPLICATE)
+      {
+        ++slice.Duplicates_;
+        continue;
+      }
+
+      OAHTSlot& slot = table[index];
+      slot.Data = First[i].second;
+      if (slot.State == OAHTSlot::DELETED)
+      {
+        ++slice.Reused_;
+      }
+      if (config.ArenaKeys_)
+      {
+        slot.KeyOffset = offsets[i];
+        memcpy(&arena[offsets[i]], key, info[i].Len + 1);
+      }
+      else if constexpr (!K::Arena)
+      {
+        memcpy(slot.Key, key, info[i].Len);
+        slot.Key[info[i].Len] = '\0';
+      }
+      slot.State = OAHTSlot::OCCUPIED;
+      slot.Hash = info[i].Hash;
+      slot.Len = info[i].Len;
+      slot.probes = 0;
+      if (ctrl)
+      {
+        SetCtrl(index, info[i].Tag);
+      }
+      ++slice.Count_;
+      slice.Bytes_ += config.ArenaKeys_ ? info[i].Len + 1 : 0;
+    }
+  });
+
+  // Fold the slices into the stats even if one of them failed part way
+  unsigned placed_bytes = 0;
+  for (const Slice& slice : slices)
+  {
+    stats.Probes_ += slice.Probes_;
+    stats.Count_ += slice.Count_;
+    stats.Tombstones_ -= slice.Reused_;
+    duplicates += slice.Duplicates_;
+    placed_bytes += slice.Bytes_;
+    for (unsigned j = 0; j < OAHT_HISTOGRAM_BUCKETS; ++j)
+    {
+      stats.ProbeHistogram_[j] += slice.ProbeHistogram_[j];
+    }
+  }
+
+  // Room set aside for keys that were not placed is never used
+  if (config.ArenaKeys_)
+  {
+    arena_garbage += arena_end - bytes_start - placed_bytes;
+  }
+  if (error)
+  {
+    std::rethrow_exception(error);
+  }
+
+  // Keys that ran out of their slice go in one at a time, in input order 
+  // within each slice, so duplicates among them still keep the first
+  for (const Slice& slice : slices)
+  {
+    for (unsigned i : slice.Spilled_)
+    {
+      const char *key = OAHTKeyChars(First[i].first);
+      unsigned index = ClaimSlot(key, info[i]);
+      if (index == OAHT_DUPLICATE)
+      {
+        ++duplicates;
+        continue;
+      }
+      table[index].Data = First[i].second;
+    }
+  }
+
+  return duplicates;
+}
+
+/******************************************************************************
+ * @brief Finds the data by key and returns a pointer to it, or null if Key 
+ * isn't found. The number of probes is added to Probes instead of the 
+ * table's stats, so any number of threads may call this at once as long as 
+ * nothing modifies the table.
+ * 
+ * @tparam T 
+ * @param Key 
+ * @param Probes 
+ * @return const T* 
+ *****************************************************************************/
+template<class T, class H, class K> const T * 
+OAHashTable<T, H, K>::lookup(const char *Key, 
+  unsigned &Probes) const
+{
+  return LookupHashed(Key, HashKey(Key), Probes);
+}
+
+/******************************************************************************
+ * @brief Removes all Key/Data pairs in the table, freeing the data if 
+ * necessary. This does not free the hash table itself. If a FreeProc was 
+ * provided, you must pass the data in each slot to that function and then 
+ * set the slot as unoccupied.
+ * 
+ * @tparam T 
+ *****************************************************************************/
+template<class T, class H, class K> void OAHashTable<T, H, K>::clear()
+{
+  // Snapshots are copied out on the first write
+  if (mapping)
+  {
+    Promote();
+  }
+
+  for (unsigned i = 0; i < stats.TableSize_; ++i)
+  {
+    if(config.FreeProc_ && table[i].State == OAHTSlot::OCCUPIED)
+    {
+      config.FreeProc_(table[i].Data);
+    }
+    table[i].State = OAHTSlot::UNOCCUPIED;
+    //table[i].probes = 0;
+  }
+  if (ctrl)
+  {
+    memset(ctrl, CTRL_EMPTY, stats.TableSize_ + GROUP_WIDTH - 1);
+  }
+
+  // Drop whatever has not been migrated yet
+  if (migrate_table)
+  {
+    for (unsigned i = migrate_pos; i < migrate_size; ++i)
+    {
+      if(config.FreeProc_ && migrate_table[i].State == OAHTSlot::OCCUPIED)
+      {
+        config.FreeProc_(migrate_table[i].Data);
+      }
+    }
+    FreeSlots(migrate_table, migrate_size);
+    migrate_table = 0;
+  }
+
+  // A table that is still being built holds no entries yet
+  if (grow_table)
+  {
+    FreeSlots(grow_table, grow_pos);
+    delete [] grow_ctrl;
+    grow_table = 0;
+    grow_ctrl = 0;
+  }
+
+  arena.clear();
+  arena_garbage = 0;
+  stats.Count_ = 0;
+  stats.Tombstones_ = 0;
+  UpdateMemory(0);
+}
+
+/******************************************************************************
+ * @brief Returns a struct that contains information on the status of the 
+ * table for debugging and testing. The struct is defined in the header file. 
+ * Everything but LongestCluster_ (and, for Robin Hood tables, the probe 
+ * lengths) is kept up to date as the table changes, so by default this is 
+ * O(1). Those fields need a pass over every slot and are only filled in 
+ * when Scan is set. Nothing in the table is written either way.
+ * 
+ * @tparam T 
+ * @param Scan // walk the table for the cluster and probe length fields 
+ * @return OAHTStats 
+ *****************************************************************************/
+template<class T, class H, class K> OAHTStats 
+OAHashTable<T, H, K>::GetStats(bool Scan) const
+{
+  OAHTStats result = stats;
+  result.TombstoneRatio_ = stats.TableSize_ ? 
+    static_cast<double>(stats.Tombstones_) / stats.TableSize_ : 0.0;
+
+  if (!Scan)
+  {
+    return result;
+  }
+
+  // Robin Hood tables keep each entry's distance from home in its slot
+  if (config.DeletionPolicy_ == OAHTDeletionPolicy::ROBINHOOD)
+  {
+    unsigned long long total = 0;
+    unsigned longest = 0;
+    unsigned count = 0;
+    for (unsigned i = 0; i < stats.TableSize_; ++i)
+    {
+      if (table[i].State == OAHTSlot::OCCUPIED)
+      {
+        unsigned length = static_cast<unsigned>(table[i].probes) + 1;
+        total += length;
+        longest = length > longest ? length : longest;
+        ++count;
+      }
+    }
+    result.MeanProbeLength_ = count ? static_cast<double>(total) / count 
+                                    : 0.0;
+    result.MaxProbeLength_ = longest;
+  }
+
+  // Deleted slots keep probe sequences going, so they count towards clusters
+  unsigned longest_cluster = 0;
+  unsigned run = 0;
+  unsigned leading = 0;
+  for (unsigned i = 0; i < stats.TableSize_; ++i)
+  {
+    if (table[i].State == OAHTSlot::UNOCCUPIED)
+    {
+      if (run == i)
+      {
+        leading = run;
+      }
+      run = 0;
+      continue;
+    }
+
+    ++run;
+    longest_cluster = run > longest_cluster ? run : longest_cluster;
+  }
+
+  // The run at the end of the table continues at the start
+  if (run == stats.TableSize_)
+  {
+    longest_cluster = run;
+  }
+  else if (run + leading > longest_cluster)
+  {
+    longest_cluster = run + leading;
+  }
+
+  result.LongestCluster_ = longest_cluster;
+  return result;
+}
+
+/******************************************************************************
+ * @brief Get the table
+ * 
+ * @tparam T 
+ * @return const OAHashTable<T, H, K>::OAHTSlot* 
+ *****************************************************************************/
+template<class T, class H, class K> const typename 
+OAHashTable<T, H, K>::OAHTSlot* 
+OAHashTable<T, H, K>::GetTable() const
+{
+  return table;
+}
+
+/******************************************************************************
+ * @brief Writes the table to Path as a flat snapshot that Load can map back 
+ * in without rehashing. Only tables of trivially copyable T can be saved. 
+ * Any in-flight incremental resize is finished first. Throws an exception 
+ * if the file cannot be written. (E_SNAPSHOT)
+ * 
+ * @tparam T 
+ * @param Path 
+ *****************************************************************************/
+template<class T, class H, class K> void 
+OAHashTable<T, H, K>::Save(const char *Path)
+{
+  static_assert(std::is_trivially_copyable<T>::value,
+    "Only tables of trivially copyable data can be saved");
+
+  if (grow_table || migrate_table)
+  {
+    FinishResize();
+  }
+
+  const char *keys = mapped_keys ? mapped_keys : arena.data();
+  unsigned long long keys_size = mapped_keys ? mapped_keys_size : arena.size();
+
+  // Lay the file out so every section is aligned for the slots it holds
+  OAHTSnapshotHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.Magic_, OAHT_SNAPSHOT_MAGIC, sizeof(header.Magic_));
+  header.Version_ = OAHT_SNAPSHOT_VERSION;
+  header.SlotSize_ = sizeof(OAHTSlot);
+  header.DataSize_ = sizeof(T);
+  header.Flags_ = (ctrl ? OAHT_SNAPSHOT_CTRL : 0) |
+                  (config.StoreHash_ ? OAHT_SNAPSHOT_HASH : 0) |
+                  (config.ArenaKeys_ ? OAHT_SNAPSHOT_ARENA : 0) |
+                  (hasher.HasSecondary() ? OAHT_SNAPSHOT_SECONDARY : 0) |
+                  (K::Arena ? OAHT_SNAPSHOT_COMPACT : 0);
+  header.DeletionPolicy_ = config.DeletionPolicy_;
+  header.CapacityPolicy_ = config.CapacityPolicy_;
+  header.HashCheck_ = SnapshotHashCheck(stats.TableSize_, config.StoreHash_);
+  header.TableSize_ = stats.TableSize_;
+  header.Count_ = stats.Count_;
+  header.Probes_ = stats.Probes_;
+  header.Expansions_ = stats.Expansions_;
+  header.Compactions_ = stats.Compactions_;
+  header.Tombstones_ = stats.Tombstones_;
+  memcpy(header.ProbeHistogram_, stats.ProbeHistogram_, 
+    sizeof(header.ProbeHistogram_));
+  header.ArenaGarbage_ = arena_garbage;
+  header.SlotsOffset_ = SnapshotAlign(sizeof(header));
+  header.CtrlOffset_ = header.SlotsOffset_ + 
+    static_cast<unsigned long long>(stats.TableSize_) * sizeof(OAHTSlot);
+  header.KeysOffset_ = header.CtrlOffset_ + 
+    (ctrl ? stats.TableSize_ + GROUP_WIDTH - 1 : 0);
+  header.KeysSize_ = keys_size;
+  header.FileSize_ = header.KeysOffset_ + keys_size;
+
+  // Write next to the target and rename over it, so a crash never leaves a 
+  // half-written snapshot and a table mapping the old file keeps working
+  std::string temp_path = std::string(Path) + ".tmp";
+  std::FILE *file = std::fopen(temp_path.c_str(), "wb");
+  if (!file)
+  {
+    throw (OAHashTableException(OAHashTableException::E_SNAPSHOT,
+      "The snapshot file could not be created"));
+  }
+
+  static const char padding[alignof(OAHTSlot)] = {0};
+  bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+  ok = ok && std::fwrite(padding, 1, header.SlotsOffset_ - sizeof(header), 
+    file) == header.SlotsOffset_ - sizeof(header);
+  ok = ok && std::fwrite(table, sizeof(OAHTSlot), stats.TableSize_, file) == 
+    stats.TableSize_;
+  if (ctrl)
+  {
+    ok = ok && std::fwrite(ctrl, 1, stats.TableSize_ + GROUP_WIDTH - 1, 
+      file) == stats.TableSize_ + GROUP_WIDTH - 1;
+  }
+  if (keys_size)
+  {
+    ok = ok && std::fwrite(keys, 1, keys_size, file) == keys_size;
+  }
+  ok = std::fclose(file) == 0 && ok;
+
+#ifdef _MSC_VER
+  // rename does not replace an existing file here
+  if (ok)
+  {
+    std::remove(Path);
+  }
+#endif
+  ok = ok && std::rename(temp_path.c_str(), Path) == 0;
+
+  if (!ok)
+  {
+    std::remove(temp_path.c_str());
+    throw (OAHashTableException(OAHashTableException::E_SNAPSHOT,
+      "The snapshot file could not be written"));
+  }
+}
+
+/******************************************************************************
+ * @brief Replaces the contents of the table with a snapshot written by Save. 
+ * The file is mapped read-only and used in place, so loading does no work 
+ * per entry. The table must have been configured with the same hash 
+ * functions the snapshot was saved with; the options that change the stored 
+ * layout (deletion and capacity policy, control bytes, stored hashes, arena 
+ * keys) are taken from the file. The key policy K must match the one the 
+ * snapshot was saved with. The first insert, remove or clear copies the 
+ * table out of the mapping (see Promote). Throws an exception if the file 
+ * is missing, truncated, from another format version, built with other 
+ * hash functions, or has header fields (policies, flags, counts) that no 
+ * table could have saved. (E_SNAPSHOT, E_NO_MEMORY) 
+ * 
+ * Snapshot files must be trusted. Only the header is checked, to catch the 
+ * wrong file or a save from an incompatible build; the slots, control bytes 
+ * and arena are used as they are, so a file that has been tampered with or 
+ * damaged past its header can make lookups read out of bounds, loop or 
+ * return wrong data. Do not load snapshots from untrusted sources.
+ * 
+ * @tparam T 
+ * @param Path 
+ *****************************************************************************/
+template<class T, class H, class K> void 
+OAHashTable<T, H, K>::Load(const char *Path)
+{
+  static_assert(std::is_trivially_copyable<T>::value,
+    "Only tables of trivially copyable data can be loaded");
+
+  char *base = 0;
+  unsigned long long size = 0;
+
+#ifdef _MSC_VER
+  // No mmap here; read the whole file in one go instead
+  std::FILE *file = std::fopen(Path, "rb");
+  if (!file)
+  {
+    throw (OAHashTableException(OAHashTableException::E_SNAPSHOT,
+      "The snapshot file could not be opened"));
+  }
+  _fseeki64(file, 0, SEEK_END);
+  size = static_cast<unsigned long long>(_ftelli64(file));
+  _fseeki64(file, 0, SEEK_SET);
+  try
+  {
+    base = new char[size ? size : 1];
+  }
+  catch(const std::bad_alloc&)
+  {
+    std::fclose(file);
+    throw (OAHashTableException(OAHashTableException::E_NO_MEMORY,
+      "The table does not have enough memory"));
+  }
+  bool ok = std::fread(base, 1, size, file) == size;
+  std::fclose(file);
+  if (!ok)
+  {
+    delete [] base;
+    throw (OAHashTableException(OAHashTableException::E_SNAPSHOT,
+      "The snapshot file could not be read"));
+  }
+#else
+  int fd = open(Path, O_RDONLY);
+  if (fd < 0)
+  {
+    throw (OAHashTableException(OAHashTableException::E_SNAPSHOT,
+      "The snapshot file could not be opened"));
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size == 0)
+  {
+    close(fd);
+    throw (OAHashTableException(OAHashTableException::E_SNAPSHOT,
+      "The snapshot file could not be read"));
+  }
+  size = static_cast<unsigned long long>(info.st_size);
+
+  // Private and read-only: pages are shared with the page cache and any 
+  // stray write faults instead of reaching the file
+  void *address = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (address == MAP_FAILED)
+  {
+    throw (OAHashTableException(OAHashTableException::E_SNAPSHOT,
+      "The snapshot file could not be mapped"));
+  }
+  base = static_cast<char *>(address);
+#endif
+
+  // Check the header before touching anything else
+  OAHTSnapshotHeader header;
+  const char *error = 0;
+  if (size < sizeof(header))
+  {
+    error = "The snapshot file is truncated";
+  }
+  else
+  {
+    memcpy(&header, base, sizeof(header));
+    if (memcmp(header.Magic_, OAHT_SNAPSHOT_MAGIC, sizeof(header.Magic_)))
+    {
+      error = "The file is not a snapshot";
+    }
+    else if (header.Version_ != OAHT_SNAPSHOT_VERSION || 
+      header.SlotSize_ != sizeof(OAHTSlot) || header.DataSize_ != sizeof(T) ||
+      !(header.Flags_ & OAHT_SNAPSHOT_COMPACT) != !K::Arena)
+    {
+      error = "The snapshot was saved by an incompatible table";
+    }
+    else if (header.FileSize_ > size || header.TableSize_ == 0 || 
+      header.SlotsOffset_ != SnapshotAlign(sizeof(header)) ||
+      header.CtrlOffset_ != header.SlotsOffset_ + 
+        static_cast<unsigned long long>(header.TableSize_) * sizeof(OAHTSlot) ||
+      header.KeysOffset_ != header.CtrlOffset_ + 
+        (header.Flags_ & OAHT_SNAPSHOT_CTRL ? 
+          header.TableSize_ + GROUP_WIDTH - 1 : 0) ||
+      header.KeysOffset_ + header.KeysSize_ != header.FileSize_)
+    {
+      error = "The snapshot file is truncated";
+    }
+    else if (header.DeletionPolicy_ > OAHTDeletionPolicy::ROBINHOOD || 
+      header.CapacityPolicy_ > OAHTCapacityPolicy::POWER_OF_TWO ||
+      (header.CapacityPolicy_ == OAHTCapacityPolicy::POWER_OF_TWO && 
+        ((header.TableSize_ & (header.TableSize_ - 1)) != 0 || 
+        !(header.Flags_ & OAHT_SNAPSHOT_HASH))) ||
+      header.Flags_ >= OAHT_SNAPSHOT_COMPACT * 2 ||
+      (K::Arena && (!(header.Flags_ & OAHT_SNAPSHOT_ARENA) || 
+        !(header.Flags_ & OAHT_SNAPSHOT_HASH))) ||
+      header.Count_ > header.TableSize_ || 
+      header.Tombstones_ > header.TableSize_ - header.Count_ ||
+      header.ArenaGarbage_ > header.KeysSize_)
+    {
+      error = "The snapshot header has fields out of range";
+    }
+    else if (header.HashCheck_ != SnapshotHashCheck(header.TableSize_, 
+      (header.Flags_ & OAHT_SNAPSHOT_HASH) != 0) ||
+      !(header.Flags_ & OAHT_SNAPSHOT_SECONDARY) != !hasher.HasSecondary())
+    {
+      error = "The snapshot was saved with different hash functions";
+    }
+  }
+
+  if (error)
+  {
+    UnmapMemory(base, size);
+    throw (OAHashTableException(OAHashTableException::E_SNAPSHOT, error));
+  }
+
+  // Drop the current contents and point the table into the file
+  if (mapping)
+  {
+    Unmap();
+  }
+  else
+  {
+    clear();
+    FreeSlots(table, stats.TableSize_);
+    delete [] ctrl;
+  }
+
+  mapping = base;
+  mapping_size = size;
+  table = reinterpret_cast<OAHTSlot *>(base + header.SlotsOffset_);
+  ctrl = header.Flags_ & OAHT_SNAPSHOT_CTRL ? 
+    reinterpret_cast<unsigned char *>(base + header.CtrlOffset_) : 0;
+  mapped_keys = header.KeysSize_ ? base + header.KeysOffset_ : 0;
+  mapped_keys_size = header.KeysSize_;
+  arena_garbage = header.ArenaGarbage_;
+
+  config.ControlBytes_ = ctrl != 0;
+  config.StoreHash_ = (header.Flags_ & OAHT_SNAPSHOT_HASH) != 0;
+  config.ArenaKeys_ = (header.Flags_ & OAHT_SNAPSHOT_ARENA) != 0;
+  config.DeletionPolicy_ = 
+    static_cast<OAHTDeletionPolicy>(header.DeletionPolicy_);
+  config.CapacityPolicy_ = 
+    static_cast<OAHTCapacityPolicy>(header.CapacityPolicy_);
+
+  stats.TableSize_ = header.TableSize_;
+  stats.Count_ = header.Count_;
+  stats.Probes_ = header.Probes_;
+  stats.Expansions_ = header.Expansions_;
+  stats.Compactions_ = header.Compactions_;
+  stats.Tombstones_ = header.Tombstones_;
+  memcpy(stats.ProbeHistogram_, header.ProbeHistogram_, 
+    sizeof(stats.ProbeHistogram_));
+  stats.PrimaryHashFunc_ = config.PrimaryHashFunc_;
+  stats.SecondaryHashFunc_ = config.SecondaryHashFunc_;
+  UpdateMemory(0);
+}
+
+/******************************************************************************
+ * @brief Copies a table loaded from a snapshot out of the mapped file so it 
+ * can be modified. Called automatically by the first insert, remove or 
+ * clear; does nothing if the table is not mapped. (E_NO_MEMORY)
+ * 
+ * @tparam T 
+ *****************************************************************************/
+template<class T, class H, class K> void OAHashTable<T, H, K>::Promote()
+{
+  if (!mapping)
+  {
+    return;
+  }
+
+  OAHTSlot* new_table = 0;
+  unsigned char* new_ctrl = 0;
+  try
+  {
+    new_table = AllocSlots(stats.TableSize_);
+    if (ctrl)
+    {
+      new_ctrl = new unsigned char[stats.TableSize_ + GROUP_WIDTH - 1];
+    }
+    if (mapped_keys)
+    {
+      arena.assign(mapped_keys, mapped_keys + mapped_keys_size);
+    }
+  }
+  catch(const std::bad_alloc&)
+  {
+    FreeSlots(new_table, 0);
+    delete [] new_ctrl;
+    throw (OAHashTableException(OAHashTableException::E_NO_MEMORY,
+      "The table does not have enough memory"));
+  }
+
+  memcpy(static_cast<void *>(new_table), table, 
+    stats.TableSize_ * sizeof(OAHTSlot));
+  if (ctrl)
+  {
+    memcpy(new_ctrl, ctrl, stats.TableSize_ + GROUP_WIDTH - 1);
+  }
+
+  Unmap();
+  table = new_table;
+  ctrl = new_ctrl;
+  UpdateMemory(0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//--  HELPER FUNCTIONS  --/////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+/******************************************************************************
+ * @brief Helper function for initializing a table when it gets made
+ * 
+ * @tparam T 
+ *****************************************************************************/
+template<class T, class H, class K> void OAHashTable<T, H, K>::InitTable()
+{
+  // Initialize table
+  InitSlots(table, 0, config.InitialTableSize_);
+  if (ctrl)
+  {
+    memset(ctrl, CTRL_EMPTY, config.InitialTableSize_ + GROUP_WIDTH - 1);
+  }
+
+  // Store the initial stats from config
+  stats.TableSize_ = config.InitialTableSize_;
+  stats.Probes_ = 0;
+  stats.Expansions_ = 0;
+  stats.Count_ = 0;
+  stats.Tombstones_ = 0;
+  stats.PrimaryHashFunc_ = config.PrimaryHashFunc_;
+  stats.SecondaryHashFunc_ = config.SecondaryHashFunc_;
+}
+
+/******************************************************************************
+ * @brief Helper function for growing a table
+ * 
+ * @tparam T 
+ *****************************************************************************/
+template<class T, class H, class K> void OAHashTable<T, H, K>::GrowTable()
+{
+  // Only one resize can be in flight, so finish the previous one
+  if (grow_table || migrate_table)
+  {
+    FinishResize();
+  }
+
+  // Drop the bytes of removed keys once they outweigh the live ones
+  if (config.ArenaKeys_ && arena_garbage > arena.size() - arena_garbage)
+  {
+    CompactArena();
+  }
+
+  // Record old table size
+  unsigned old_table_size = stats.TableSize_;
+
+  // Calculate new table size
+  double factor = std::ceil(stats.TableSize_ * config.GrowthFactor_);
+  unsigned new_table_size;
+  if (config.CapacityPolicy_ == OAHTCapacityPolicy::POWER_OF_TWO)
+  {
+    new_table_size = OAHTPowerOfTwo(static_cast<unsigned>(factor));
+  }
+  else
+  {
+    new_table_size = GetClosestPrime(static_cast<unsigned>(factor));
+  }
+
+  // Entries may use half of the free slots while the new table is built
+  unsigned slack = (old_table_size - stats.Count_) / 2;
+
+  if (config.IncrementalResize_ && slack)
+  {
+    // Only allocate the new table here. It is initialized a few buckets per 
+    // operation (see InitSome) while the current table keeps taking 
+    // entries, fast enough to be ready before the slack runs out.
+    try
+    {
+      grow_table = AllocSlots(new_table_size);
+      if (ctrl)
+      {
+        grow_ctrl = new unsigned char[new_table_size + GROUP_WIDTH - 1];
+      }
+    }
+    catch(const std::bad_alloc&)
+    {
+      FreeSlots(grow_table, 0);
+      grow_table = 0;
+      throw (OAHashTableException(OAHashTableException::E_NO_MEMORY,
+        "The table does not have enough memory"));
+    }
+
+    grow_size = new_table_size;
+    grow_pos = 0;
+    grow_limit = stats.Count_ + slack;
+    grow_batch = (new_table_size + slack - 1) / slack;
+    if (grow_batch < config.MigrateBuckets_)
+    {
+      grow_batch = config.MigrateBuckets_;
+    }
+    ++stats.Expansions_;
+    UpdateMemory(0);
+    return;
+  }
+
+  // Make the new table
+  OAHTSlot* old_table = ReplaceTable(new_table_size);
+  ++stats.Expansions_;
+
+  if (config.IncrementalResize_)
+  {
+    BeginMigration(old_table, old_table_size);
+    return;
+  }
+
+  MoveSlots(old_table, old_table_size);
+}
+
+/******************************************************************************
+ * @brief Helper function that starts moving the entries of an old slot array 
+ *  into the current table a few buckets at a time (see MigrateSome). Moves 
+ *  enough per operation that the old array is empty before the current 
+ *  table can reach its own load factor limit.
+ * 
+ * @tparam T 
+ * @param OldTable 
+ * @param OldSize 
+ *****************************************************************************/
+template<class T, class H, class K> void 
+OAHashTable<T, H, K>::BeginMigration(OAHTSlot *OldTable, 
+  unsigned OldSize)
+{
+  unsigned limit = static_cast<unsigned>(config.MaxLoadFactor_ * 
+    stats.TableSize_);
+  unsigned headroom = limit > stats.Count_ ? limit - stats.Count_ : 1;
+
+  migrate_table = OldTable;
+  migrate_size = OldSize;
+  migrate_pos = 0;
+  migrate_batch = (OldSize + headroom - 1) / headroom;
+  if (migrate_batch < config.MigrateBuckets_)
+  {
+    migrate_batch = config.MigrateBuckets_;
+  }
+  UpdateMemory(0);
+}
+
+/******************************************************************************
+ * @brief Helper function that rebuilds the table in place, dropping every 
+ *  tombstone. Called when MARK deletions push the tombstone ratio past 
+ *  MaxTombstoneRatio_. No second slot array is allocated: tombstones are 
+ *  freed, every entry is marked DELETED, and each marked entry is put back 
+ *  into the first slot on its probe sequence that is not already settled, 
+ *  swapping with the marked entry there if there is one.
+ * 
+ * @tparam T 
+ *****************************************************************************/
+template<class T, class H, class K> void OAHashTable<T, H, K>::CompactTable()
+{
+  // The rebuild needs every entry in the current table
+  if (grow_table || migrate_table)
+  {
+    FinishResize();
+  }
+
+  if (config.ArenaKeys_ && arena_garbage)
+  {
+    CompactArena();
+  }
+
+  // Free the tombstones and mark every entry as not yet placed
+  for (unsigned i = 0; i < stats.TableSize_; ++i)
+  {
+    bool occupied = table[i].State == OAHTSlot::OCCUPIED;
+    table[i].State = occupied ? OAHTSlot::DELETED : OAHTSlot::UNOCCUPIED;
+    if (ctrl)
+    {
+      SetCtrl(i, occupied ? CTRL_DELETED : CTRL_EMPTY);
+    }
+  }
+  stats.Tombstones_ = 0;
+  ++stats.Compactions_;
+
+  for (unsigned i = 0; i < stats.TableSize_; ++i)
+  {
+    // An entry swapped into slot i still has to be placed itself
+    while (table[i].State == OAHTSlot::DELETED)
+    {
+      OAHTKeyInfo info = SlotInfo(table[i]);
+      unsigned index = info.Home;
+
+      ++stats.Probes_;
+      while (table[index].State == OAHTSlot::OCCUPIED)
+      {
+        ++stats.Probes_;
+        index = OAHTAdvance(index, info.Step, stats.TableSize_);
+      }
+
+      if (index != i && table[index].State == OAHTSlot::DELETED)
+      {
+        std::swap(table[i], table[index]);
+      }
+      else if (index != i)
+      {
+        table[index] = std::move(table[i]);
+        table[i].State = OAHTSlot::UNOCCUPIED;
+        if (ctrl)
+        {
+          SetCtrl(i, CTRL_EMPTY);
+        }
+      }
+
+      table[index].State = OAHTSlot::OCCUPIED;
+      if (ctrl)
+      {
+        SetCtrl(index, info.Tag);
+      }
+    }
+  }
+}
+
+/******************************************************************************
+ * @brief Helper function that swaps in an empty slot array (and control 
+ *  bytes) of the given size and returns the old slot array, which the 
+ *  caller must empty and delete.
+ * 
+ * @tparam T 
+ * @param Size 
+ * @return OAHashTable<T, H, K>::OAHTSlot* 
+ *****************************************************************************/
+template<class T, class H, class K> typename OAHashTable<T, H, K>::OAHTSlot* 
+OAHashTable<T, H, K>::ReplaceTable(unsigned Size)
+{
+  OAHTSlot* new_table = 0;
+  unsigned char* new_ctrl = 0;
+  try
+  {
+    new_table = AllocSlots(Size);
+    if (ctrl)
+    {
+      new_ctrl = new unsigned char[Size + GROUP_WIDTH - 1];
+    }
+  }
+  catch(const std::bad_alloc&)
+  {
+    FreeSlots(new_table, 0);
+    throw (OAHashTableException(OAHashTableException::E_NO_MEMORY,
+      "The table does not have enough memory"));
+  }
+
+  // Initialize table
+  try
+  {
+    InitSlots(new_table, 0, Size);
+  }
+  catch(...)
+  {
+    FreeSlots(new_table, 0);
+    delete [] new_ctrl;
+    throw;
+  }
+  if (new_ctrl)
+  {
+    memset(new_ctrl, CTRL_EMPTY, Size + GROUP_WIDTH - 1);
+  }
+
+  return SwapTable(new_table, new_ctrl, Size);
+}
+
+/******************************************************************************
+ * @brief Helper function that makes an initialized slot array (and control 
+ *  bytes) of the given size the current table and returns the old slot 
+ *  array, which the caller must empty and free.
+ * 
+ * @tparam T 
+ * @param NewTable 
+ * @param NewCtrl 
+ * @param Size 
+ * @return OAHashTable<T, H, K>::OAHTSlot* 
+ *****************************************************************************/
+template<class T, class H, class K> typename OAHashTable<T, H, K>::OAHTSlot* 
+OAHashTable<T, H, K>::SwapTable(OAHTSlot *NewTable, unsigned char *NewCtrl, 
+  unsigned Size)
+{
+  OAHTSlot* old_table = table;
+  unsigned char* old_ctrl = ctrl;
+  table = NewTable;
+  ctrl = NewCtrl;
+
+  // Both arrays are alive until the caller empties the old one
+  unsigned long long old_bytes = 
+    static_cast<unsigned long long>(stats.TableSize_) * sizeof(OAHTSlot);
+  if (old_ctrl)
+  {
+    old_bytes += stats.TableSize_ + GROUP_WIDTH - 1;
+  }
+  stats.TableSize_ = Size;
+  UpdateMemory(old_bytes);
+
+  // The old control bytes are never needed again, and tombstones stay 
+  // behind with the old slots
+  delete [] old_ctrl;
+  stats.Tombstones_ = 0;
+
+  return old_table;
+}
+
+/******************************************************************************
+ * @brief Helper function that moves every entry of an old slot array into 
+ *  the current table and deletes the old array
+ * 
+ * @tparam T 
+ * @param OldTable 
+ * @param OldSize 
+ *****************************************************************************/
+template<class T, class H, class K> void 
+OAHashTable<T, H, K>::MoveSlots(OAHTSlot *OldTable, 
+  unsigned OldSize)
+{
+  // Move slots over. They are already unique, so skip the duplicate checks
+  // in insert and just find each one a free slot.
+  stats.Count_ = 0;
+  for (unsigned i = 0; i < OldSize; ++i)
+  {
+    if (OldTable[i].State == OAHTSlot::OCCUPIED)
+    {
+      PlaceSlot(OldTable[i]);
+      ++stats.Count_;
+    }
+  }
+
+  // Delete the old table
+  FreeSlots(OldTable, OldSize);
+  UpdateMemory(0);
+}
+
+/******************************************************************************
+ * @brief Helper function that allocates room for Size slots without 
+ *  constructing any of them, so a new table costs nothing per slot until it 
+ *  is initialized (see InitSlots)
+ * 
+ * @tparam T 
+ * @param Size 
+ * @return OAHashTable<T, H, K>::OAHTSlot* 
+ *****************************************************************************/
+template<class T, class H, class K> typename OAHashTable<T, H, K>::OAHTSlot* 
+OAHashTable<T, H, K>::AllocSlots(unsigned Size)
+{
+  return static_cast<OAHTSlot *>(::operator new(
+    static_cast<size_t>(Size) * sizeof(OAHTSlot), 
+    std::align_val_t(alignof(OAHTSlot))));
+}
+
+/******************************************************************************
+ * @brief Helper function that destroys the first Constructed slots of an 
+ *  array from AllocSlots and frees it. Does nothing for a null array.
+ * 
+ * @tparam T 
+ * @param Slots 
+ * @param Constructed 
+ *****************************************************************************/
+template<class T, class H, class K> void 
+OAHashTable<T, H, K>::FreeSlots(OAHTSlot *Slots, 
+  unsigned Constructed)
+{
+  if (!Slots)
+  {
+    return;
+  }
+
+  for (unsigned i = 0; i < Constructed; ++i)
+  {
+    Slots[i].~OAHTSlot();
+  }
+  ::operator delete(Slots, std::align_val_t(alignof(OAHTSlot)));
+}
+
+/******************************************************************************
+ * @brief Helper function that constructs slots [First, Last) of an array 
+ *  from AllocSlots as unoccupied. If a constructor throws, the slots built 
+ *  by this call are destroyed again.
+ * 
+ * @tparam T 
+ * @param Slots 
+ * @param First 
+ * @param Last 
+ *****************************************************************************/
+template<class T, class H, class K> void 
+OAHashTable<T, H, K>::InitSlots(OAHTSlot *Slots, 
+  unsigned First, unsigned Last)
+{
+  unsigned i = First;
+  try
+  {
+    for (; i < Last; ++i)
+    {
+      new (&Slots[i]) OAHTSlot;
+      Slots[i].State = OAHTSlot::UNOCCUPIED;
+      Slots[i].probes = 0;
+    }
+  }
+  catch(...)
+  {
+    while (i > First)
+    {
+      Slots[--i].~OAHTSlot();
+    }
+    throw;
+  }
+}
+
+/******************************************************************************
+ * @brief Helper function that releases the mapped snapshot the table points 
+ *  into. The caller must point table and ctrl somewhere else afterwards.
+ * 
+ * @tparam T 
+ *****************************************************************************/
+template<class T, class H, class K> void OAHashTable<T, H, K>::Unmap()
+{
+  UnmapMemory(mapping, mapping_size);
+  mapping = 0;
+  mapping_size = 0;
+  mapped_keys = 0;
+  mapped_keys_size = 0;
+  table = 0;
+  ctrl = 0;
+}
+
+/******************************************************************************
+ * @brief Helper function that releases memory from Load, which is a file 
+ *  mapping on POSIX and a heap buffer elsewhere
+ * 
+ * @tparam T 
+ * @param Base 
+ * @param Size 
+ *****************************************************************************/
+template<class T, class H, class K> void 
+OAHashTable<T, H, K>::UnmapMemory(char *Base, 
+  unsigned long long Size)
+{
+#ifdef _MSC_VER
+  (void)Size;
+  delete [] Base;
+#else
+  munmap(Base, Size);
+#endif
+}
+
+/******************************************************************************
+ * @brief Helper function that rounds a snapshot file offset up so the 
+ *  section starting there is aligned for the slots
+ * 
+ * @tparam T 
+ * @param Offset 
+ * @return unsigned long long 
+ *****************************************************************************/
+template<class T, class H, class K> unsigned long long 
+OAHashTable<T, H, K>::SnapshotAlign(
+  unsigned long long Offset)
+{
+  unsigned long long align = alignof(OAHTSlot);
+  return (Offset + align - 1) / align * align;
+}
+
+/******************************************************************************
+ * @brief Helper function that runs a fixed key through the hash functions. 
+ *  Saved with a snapshot and compared on load, so a table configured with 
+ *  other hash functions does not silently fail every lookup.
+ * 
+ * @tparam T 
+ * @param Size 
+ * @param StoreHash 
+ * @return unsigned 
+ *****************************************************************************/
+template<class T, class H, class K> unsigned 
+OAHashTable<T, H, K>::SnapshotHashCheck(unsigned Size, 
+  bool StoreHash) const
+{
+  const unsigned length = sizeof(OAHT_SNAPSHOT_PROBE_KEY) - 1;
+  unsigned check = hasher.Primary(OAHT_SNAPSHOT_PROBE_KEY, length, Size);
+  if (StoreHash)
+  {
+    check ^= hasher.Primary(OAHT_SNAPSHOT_PROBE_KEY, length, OAHT_HASH_RANGE);
+  }
+  if constexpr (H::DoubleHashing)
+  {
+    if (hasher.HasSecondary())
+    {
+      check = check * 31 + 
+        hasher.Secondary(OAHT_SNAPSHOT_PROBE_KEY, length, Size - 1);
+    }
+  }
+  return check;
+}
+
+/******************************************************************************
+ * @brief Helper function for writing a control byte. The first 
+ *  GROUP_WIDTH - 1 bytes are mirrored past the end of the array so group 
+ *  loads near the end of the table see the wrapped-around slots.
+ * 
+ * @tparam T 
+ * @param Index 
+ * @param Value 
+ *****************************************************************************/
+template<class T, class H, class K> void 
+OAHashTable<T, H, K>::SetCtrl(unsigned Index, 
+  unsigned char Value)
+{
+  ctrl[Index] = Value;
+  for (unsigned i = Index; i < GROUP_WIDTH - 1; i += stats.TableSize_)
+  {
+    ctrl[stats.TableSize_ + i] = Value;
+  }
+}
+
+
+/******************************************************************************
+ * @brief Helper function that maps a full 32-bit hash to a slot in a table 
+ *  of the given size. Power-of-two tables use a mask instead of a division.
+ * 
+ * @tparam T 
+ * @param Hash 
+ * @param Size 
+ * @return unsigned 
+ *****************************************************************************/
+template<class T, class H, class K> unsigned 
+OAHashTable<T, H, K>::HomeIndex(unsigned Hash, 
+  unsigned Size) const
+{
+  if (config.CapacityPolicy_ == OAHTCapacityPolicy::POWER_OF_TWO)
+  {
+    return Hash & (Size - 1);
+  }
+
+  return Hash % Size;
+}
+
+/******************************************************************************
+ * @brief Helper function that returns the distance between probes for Key 
+ *  in a table of the given size. Robin Hood tables always probe linearly. 
+ *  Power-of-two tables use odd steps so double hashing still covers the 
+ *  whole table.
+ * 
+ * @tparam T 
+ * @param Key 
+ * @param Length 
+ * @param Size 
+ * @return unsigned 
+ *****************************************************************************/
+template<class T, class H, class K> unsigned 
+OAHashTable<T, H, K>::ProbeStep(const char *Key, 
+  unsigned Length, unsigned Size) const
+{
+  // Policies without double hashing have no secondary hash to call
+  if constexpr (!H::DoubleHashing)
+  {
+    return 1;
+  }
+  else
+  {
+    if (!hasher.HasSecondary() || 
+      config.DeletionPolicy_ == OAHTDeletionPolicy::ROBINHOOD)
+    {
+      return 1;
+    }
+
+    unsigned step = hasher.Secondary(Key, Length, Size - 1) + 1;
+
+    // Any odd step visits every slot of a power-of-two table
+    if (config.CapacityPolicy_ == OAHTCapacityPolicy::POWER_OF_TWO)
+    {
+      step |= 1;
+    }
+
+    return step;
+  }
+}
+
+/******************************************************************************
+ * @brief Helper function that returns the length of a null-terminated key, 
+ *  or of the part of it that fits in a slot when keys are not kept in the 
+ *  arena. Longer keys are never read past that point.
+ * 
+ * @tparam T 
+ * @param Key 
+ * @return unsigned 
+ *****************************************************************************/
+template<class T, class H, class K> unsigned 
+OAHashTable<T, H, K>::KeyLength(const char *Key) const
+{
+  if (config.ArenaKeys_)
+  {
+    return static_cast<unsigned>(strlen(Key));
+  }
+
+  unsigned length = 0;
+  while (length < MAX_KEYLEN - 1 && Key[length])
+  {
+    ++length;
+  }
+  return length;
+}
+
+/******************************************************************************
+ * @brief Helper function that hashes a null-terminated key once for a whole 
+ *  operation.
+ * 
+ * @tparam T 
+ * @param Key 
+ * @return OAHTKeyInfo 
+ *****************************************************************************/
+template<class T, class H, class K> OAHTKeyInfo 
+OAHashTable<T, H, K>::HashKey(const char *Key) const
+{
+  return HashKey(Key, KeyLength(Key));
+}
+
+/******************************************************************************
+ * @brief Helper function that hashes the first Length bytes of a key once 
+ *  for a whole operation. Without ArenaKeys_ only the part of the key that 
+ *  fits in the slot is hashed and compared. Key need not be null-terminated 
+ *  unless H needs C strings. With StoreHash_ the primary hash function is 
+ *  called over a fixed 32-bit range and reduced here, so the result can be 
+ *  kept in the slot and reused when the table grows.
+ * 
+ * @tparam T 
+ * @param Key 
+ * @param Length 
+ * @return OAHTKeyInfo 
+ *****************************************************************************/
+template<class T, class H, class K> OAHTKeyInfo 
+OAHashTable<T, H, K>::HashKey(const char *Key, unsigned Length) const
+{
+  OAHTKeyInfo info;
+  info.Hash = 0;
+
+  // Length of the part of the key that gets stored
+  info.Len = Length;
+  if (!config.ArenaKeys_ && info.Len > MAX_KEYLEN - 1)
+  {
+    info.Len = MAX_KEYLEN - 1;
+  }
+
+  if (config.StoreHash_)
+  {
+    info.Hash = hasher.Primary(Key, info.Len, OAHT_HASH_RANGE);
+
+    // Masking only looks at the low bits, so weak hashes get mixed first
+    if (config.CapacityPolicy_ == OAHTCapacityPolicy::POWER_OF_TWO)
+    {
+      info.Hash = OAHTMix(info.Hash);
+    }
+    info.Home = HomeIndex(info.Hash, stats.TableSize_);
+  }
+  else
+  {
+    info.Home = hasher.Primary(Key, info.Len, stats.TableSize_);
+  }
+
+  info.Step = ProbeStep(Key, info.Len, stats.TableSize_);
+
+  info.Tag = 0;
+  if (ctrl)
+  {
+    info.Tag = OAHTFingerprint(config.StoreHash_ ? info.Hash 
+                                                 : OAHTKeyHash(Key, info.Len));
+  }
+
+  return info;
+}
+
+/******************************************************************************
+ * @brief Helper function that rebuilds the hashing info of a slot that is 
+ *  already in the table. Only the secondary hash (if any) has to be 
+ *  recomputed when the slot stores its primary hash.
+ * 
+ * @tparam T 
+ * @param Slot 
+ * @return OAHTKeyInfo 
+ *****************************************************************************/
+template<class T, class H, class K> OAHTKeyInfo 
+OAHashTable<T, H, K>::SlotInfo(const OAHTSlot &Slot) const
+{
+  if (!config.StoreHash_)
+  {
+    return HashKey(SlotKey(Slot), Slot.Len);
+  }
+
+  OAHTKeyInfo info;
+  info.Hash = Slot.Hash;
+  info.Len = Slot.Len;
+  info.Home = HomeIndex(Slot.Hash, stats.TableSize_);
+  info.Step = ProbeStep(SlotKey(Slot), Slot.Len, stats.TableSize_);
+  info.Tag = OAHTFingerprint(Slot.Hash);
+
+  return info;
+}
+
+/******************************************************************************
+ * @brief Helper function that returns the full key of an occupied slot. 
+ *  With ArenaKeys_ the key lives in the arena (null-terminated) and the slot 
+ *  only holds its offset and length.
+ * 
+ * @tparam T 
+ * @param Slot 
+ * @return const char* 
+ *****************************************************************************/
+template<class T, class H, class K> const char* 
+OAHashTable<T, H, K>::SlotKey(const OAHTSlot &Slot) const
+{
+  if constexpr (!K::Arena)
+  {
+    if (!config.ArenaKeys_)
+    {
+      return Slot.Key;
+    }
+  }
+
+  return (mapped_keys ? mapped_keys : arena.data()) + Slot.KeyOffset;
+}
+
+/******************************************************************************
+ * @brief Helper function that rebuilds the key arena with only the keys of 
+ *  occupied slots, updating their offsets. Must not run while an 
+ *  incremental resize is in flight.
+ * 
+ * @tparam T 
+ *****************************************************************************/
+template<class T, class H, class K> void OAHashTable<T, H, K>::CompactArena()
+{
+  std::vector<char> compacted;
+  compacted.reserve(arena.size() - arena_garbage);
+
+  for (unsigned i = 0; i < stats.TableSize_; ++i)
+  {
+    OAHTSlot& slot = table[i];
+    if (slot.State == OAHTSlot::OCCUPIED)
+    {
+      const char *key = arena.data() + slot.KeyOffset;
+      slot.KeyOffset = static_cast<unsigned>(compacted.size());
+      compacted.insert(compacted.end(), key, key + slot.Len + 1);
+    }
+  }
+
+  arena.swap(compacted);
+  arena_garbage = 0;
+  UpdateMemory(0);
+}
+
+/******************************************************************************
+ * @brief Helper function for comparing a key against an occupied slot. 
+ *  Slots record the length of their stored key, so keys are compared by 
+ *  length and bytes and Key need not be null-terminated. When slots store 
+ *  their hash, near-misses are rejected without touching the key bytes.
+ * 
+ * @tparam T 
+ * @param Slot 
+ * @param Key 
+ * @param Info 
+ * @return true 
+ * @return false 
+ *****************************************************************************/
+template<class T, class H, class K> bool 
+OAHashTable<T, H, K>::KeyMatches(const OAHTSlot &Slot, 
+  const char *Key, const OAHTKeyInfo &Info) const
+{
+  if (config.StoreHash_ && Slot.Hash != Info.Hash)
+  {
+    return false;
+  }
+
+  return Slot.Len == Info.Len && memcmp(Key, SlotKey(Slot), Info.Len) == 0;
+}
+
+/******************************************************************************
+ * @brief Helper function that walks the probe sequence for Key and returns 
+ *  the index of its slot, or OAHT_NPOS if it is not in the table. Probes 
+ *  are counted into the caller's counter, so lookups never write to the 
+ *  table's own stats.
+ * 
+ * @tparam T 
+ * @param Key 
+ * @param Info 
+ * @param Probes 
+ * @return unsigned 
+ *****************************************************************************/
+template<class T, class H, class K> unsigned 
+OAHashTable<T, H, K>::ProbeFindIndex(const char *Key, 
+  const OAHTKeyInfo &Info, unsigned &Probes) const
+{
+  // Walk through the table until the end of the cluster is reached
+  unsigned index = Info.Home;
+  for (unsigned i = 0; i < stats.TableSize_; ++i)
+  {
+    const OAHTSlot& slot = table[index];
+    ++Probes;
+
+    // If the slot is unoccupied, then the item does not exist
+    if (slot.State == OAHTSlot::UNOCCUPIED)
+    {
+      break;
+    }
+
+    // Robin Hood keeps clusters ordered by distance from home, so the key 
+    // would have displaced anything closer to home than it
+    if (config.DeletionPolicy_ == OAHTDeletionPolicy::ROBINHOOD && 
+      slot.probes < static_cast<int>(i))
+    {
+      break;
+    }
+
+    if (slot.State == OAHTSlot::OCCUPIED && KeyMatches(slot, Key, Info))
+    {
+      return index;
+    }
+
+    index = OAHTAdvance(index, Info.Step, stats.TableSize_);
+  }
+
+  return OAHT_NPOS;
+}
+
+/******************************************************************************
+ * @brief Helper function that finds the slot Key should be inserted into. 
+ *  Reuses the first deleted slot on the probe sequence. Returns 
+ *  OAHT_DUPLICATE if Key is already in the table.
+ * 
+ * @tparam T 
+ * @param Key 
+ * @param Info 
+ * @return unsigned 
+ *****************************************************************************/
+template<class T, class H, class K> unsigned 
+OAHashTable<T, H, K>::ProbeInsertIndex(const char *Key, 
+  const OAHTKeyInfo &Info)
+{
+  unsigned PIndex = Info.Home;
+
+  // Increment probe counter for initally finding place
+  // in hash table
+  ++stats.Probes_;
+
+  // If collision occurs. A deleted home slot can still have the key further 
+  // along its probe sequence, so keep probing for a duplicate.
+  if (table[PIndex].State != OAHTSlot::UNOCCUPIED)
+  {
+    if (table[PIndex].State == OAHTSlot::OCCUPIED && 
+      KeyMatches(table[PIndex], Key, Info))
+    {
+      return OAHT_DUPLICATE;
+    }
+
+    unsigned SIndex = Info.Step;
+    unsigned i = 1;
+    unsigned newIndex = PIndex;
+    bool foundDeleted = table[PIndex].State == OAHTSlot::DELETED;
+    unsigned targetIndex = foundDeleted ? PIndex : 0;
+
+    for (; i < stats.TableSize_; ++i)
+    {
+      // Increment probe counter
+      ++stats.Probes_;
+
+      // Get newIndex
+      newIndex = OAHTAdvance(newIndex, SIndex, stats.TableSize_);
+
+      // If duplicate is found, stop
+      if (table[newIndex].State == OAHTSlot::OCCUPIED && 
+        KeyMatches(table[newIndex], Key, Info))
+      {
+        return OAHT_DUPLICATE;
+      }
+
+      // Keep track of the first deleted slot
+      if (table[newIndex].State == OAHTSlot::DELETED && !foundDeleted)
+      {
+        targetIndex = newIndex;
+        foundDeleted = true;
+      }
+
+      // If no collision occurs, store the slot
+      if (table[newIndex].State == OAHTSlot::UNOCCUPIED)
+      {
+        // If there was a deleted slot, insert the key there
+        if (!foundDeleted)
+        {
+          targetIndex = newIndex;
+        }
+        break;
+      }
+    }
+    PIndex = targetIndex;
+  }
+
+  return PIndex;
+}
+
+/******************************************************************************
+ * @brief Helper function for bulk_insert that finds the slot Key should be 
+ *  inserted into without probing at or past End, so threads placing keys 
+ *  into different slices of a linearly probed table never touch the same 
+ *  slot. Returns OAHT_DUPLICATE if Key is already in the table and OAHT_NPOS 
+ *  if the probe sequence leaves the slice before it is settled. Probes are 
+ *  counted into the caller's counter.
+ * 
+ * @tparam T 
+ * @param Key 
+ * @param Info 
+ * @param End 
+ * @param Probes 
+ * @return unsigned 
+ *****************************************************************************/
+template<class T, class H, class K> unsigned 
+OAHashTable<T, H, K>::RangeInsertIndex(const char *Key, 
+  const OAHTKeyInfo &Info, unsigned End, unsigned &Probes) const
+{
+  unsigned targetIndex = OAHT_NPOS;
+
+  for (unsigned index = Info.Home; index < End; ++index)
+  {
+    const OAHTSlot& slot = table[index];
+    ++Probes;
+
+    // The key can only be further along if the cluster goes on
+    if (slot.State == OAHTSlot::UNOCCUPIED)
+    {
+      return targetIndex == OAHT_NPOS ? index : targetIndex;
+    }
+
+    // Keep track of the first deleted slot
+    if (slot.State == OAHTSlot::DELETED)
+    {
+      if (targetIndex == OAHT_NPOS)
+      {
+        targetIndex = index;
+      }
+    }
+    else if (KeyMatches(slot, Key, Info))
+    {
+      return OAHT_DUPLICATE;
+    }
+  }
+
+  return OAHT_NPOS;
+}
+
+/******************************************************************************
+ * @brief Control byte version of ProbeFindIndex. Only slots whose 
+ *  fingerprint matches have their key compared. With linear probing a whole 
+ *  group of GROUP_WIDTH slots is checked per probe.
+ * 
+ * @tparam T 
+ * @param Key 
+ * @param Info 
+ * @param Probes 
+ * @return unsigned 
+ *****************************************************************************/
+template<class T, class H, class K> unsigned 
+OAHashTable<T, H, K>::CtrlFindIndex(const char *Key, 
+  const OAHTKeyInfo &Info, unsigned &Probes) const
+{
+  unsigned size = stats.TableSize_;
+
+  // Double hashing visits scattered slots, so check one byte at a time
+  if (Info.Step != 1)
+  {
+    unsigned index = Info.Home;
+    for (unsigned i = 0; i < size; ++i, index = OAHTAdvance(index, 
+      Info.Step, size))
+    {
+      ++Probes;
+
+      if (ctrl[index] == CTRL_EMPTY)
+      {
+        break;
+      }
+      if (ctrl[index] == Info.Tag && KeyMatches(table[index], Key, Info))
+      {
+        return index;
+      }
+    }
+    return OAHT_NPOS;
+  }
+
+  for (unsigned pos = Info.Home, seen = 0; seen < size; seen += GROUP_WIDTH)
+  {
+    ++Probes;
+
+    unsigned match = OAHTMatchByte(ctrl + pos, Info.Tag);
+    unsigned empty = OAHTMatchByte(ctrl + pos, CTRL_EMPTY);
+
+    // Nothing past the first empty slot is on this key's probe sequence
+    if (empty)
+    {
+      match &= (empty & (0u - empty)) - 1;
+    }
+
+    for (; match; match &= match - 1)
+    {
+      unsigned index = pos + __builtin_ctz(match);
+      while (index >= size)
+      {
+        index -= size;
+      }
+      if (KeyMatches(table[index], Key, Info))
+      {
+        return index;
+      }
+    }
+
+    if (empty)
+    {
+      break;
+    }
+
+    // Tables smaller than a group wrap more than once
+    pos += GROUP_WIDTH;
+    while (pos >= size)
+    {
+      pos -= size;
+    }
+  }
+
+  return OAHT_NPOS;
+}
+
+/******************************************************************************
+ * @brief Control byte version of ProbeInsertIndex. Returns OAHT_DUPLICATE 
+ *  if Key is already in the table.
+ * 
+ * @tparam T 
+ * @param Key 
+ * @param Info 
+ * @return unsigned 
+ *****************************************************************************/
+template<class T, class H, class K> unsigned 
+OAHashTable<T, H, K>::CtrlInsertIndex(const char *Key, 
+  const OAHTKeyInfo &Info)
+{
+  unsigned size = stats.TableSize_;
+  unsigned targetIndex = OAHT_NPOS;
+
+  if (Info.Step != 1)
+  {
+    unsigned index = Info.Home;
+    for (unsigned i = 0; i < size; ++i, index = OAHTAdvance(index, 
+      Info.Step, size))
+    {
+      ++stats.Probes_;
+
+      if (ctrl[index] == Info.Tag && KeyMatches(table[index], Key, Info))
+      {
+        return OAHT_DUPLICATE;
+      }
+
+      // Keep track of the first deleted slot
+      if (ctrl[index] & CTRL_EMPTY && targetIndex == OAHT_NPOS)
+      {
+        targetIndex = index;
+      }
+      if (ctrl[index] == CTRL_EMPTY)
+      {
+        break;
+      }
+    }
+    return targetIndex;
+  }
+
+  for (unsigned pos = Info.Home, seen = 0; seen < size; seen += GROUP_WIDTH)
+  {
+    ++stats.Probes_;
+
+    unsigned match = OAHTMatchByte(ctrl + pos, Info.Tag);
+    unsigned empty = OAHTMatchByte(ctrl + pos, CTRL_EMPTY);
+    unsigned available = OAHTMatchFree(ctrl + pos);
+
+    if (empty)
+    {
+      match &= (empty & (0u - empty)) - 1;
+    }
+
+    for (; match; match &= match - 1)
+    {
+      unsigned index = pos + __builtin_ctz(match);
+      while (index >= size)
+      {
+        index -= size;
+      }
+      if (KeyMatches(table[index], Key, Info))
+      {
+        return OAHT_DUPLICATE;
+      }
+    }
+
+    // Keep track of the first deleted (or empty) slot
+    if (available && targetIndex == OAHT_NPOS)
+    {
+      targetIndex = pos + __builtin_ctz(available);
+      while (targetIndex >= size)
+      {
+        targetIndex -= size;
+      }
+    }
+
+    if (empty)
+    {
+      break;
+    }
+
+    // Tables smaller than a group wrap more than once
+    pos += GROUP_WIDTH;
+    while (pos >= size)
+    {
+      pos -= size;
+    }
+  }
+
+  return targetIndex;
+}
+
+/******************************************************************************
+ * @brief Helper function that moves an entry that is known to be unique into 
+ *  the first free slot on its probe sequence, without any key comparisons. 
+ *  Used when growing the table and when packing a cluster. Slot is left 
+ *  moved-from; the caller marks it free.
+ * 
+ * @tparam T 
+ * @param Slot 
+ * @return unsigned 
+ *****************************************************************************/
+template<class T, class H, class K> unsigned 
+OAHashTable<T, H, K>::PlaceSlot(OAHTSlot &Slot)
+{
+  OAHTKeyInfo info = SlotInfo(Slot);
+  int dist = 0;
+  unsigned index = info.Home;
+
+  if (config.DeletionPolicy_ == OAHTDeletionPolicy::ROBINHOOD)
+  {
+    index = RobinHoodIndex(0, info, dist);
+  }
+  else
+  {
+    ++stats.Probes_;
+    while (table[index].State == OAHTSlot::OCCUPIED)
+    {
+      ++stats.Probes_;
+      index = OAHTAdvance(index, info.Step, stats.TableSize_);
+    }
+
+    // Entries migrated by an incremental resize can land on a tombstone
+    if (table[index].State == OAHTSlot::DELETED)
+    {
+      --stats.Tombstones_;
+    }
+  }
+
+  if (&table[index] != &Slot)
+  {
+    table[index] = std::move(Slot);
+  }
+  table[index].State = OAHTSlot::OCCUPIED;
+  table[index].probes = dist;
+  if (ctrl)
+  {
+    SetCtrl(index, info.Tag);
+  }
+
+  return index;
+}
+
+/******************************************************************************
+ * @brief Helper function for an incremental resize. Initializes the next 
+ *  Buckets slots (and control bytes) of the table being built. Once it is 
+ *  done it becomes the current table and the entries start moving across.
+ * 
+ * @tparam T 
+ * @param Buckets 
+ *****************************************************************************/
+template<class T, class H, class K> void 
+OAHashTable<T, H, K>::InitSome(unsigned Buckets)
+{
+  unsigned end = grow_size - grow_pos < Buckets ? grow_size 
+                                                : grow_pos + Buckets;
+
+  InitSlots(grow_table, grow_pos, end);
+  if (grow_ctrl)
+  {
+    memset(grow_ctrl + grow_pos, CTRL_EMPTY, end - grow_pos);
+  }
+  grow_pos = end;
+
+  if (grow_pos < grow_size)
+  {
+    return;
+  }
+
+  // The mirrored control bytes are filled in last
+  if (grow_ctrl)
+  {
+    memset(grow_ctrl + grow_size, CTRL_EMPTY, GROUP_WIDTH - 1);
+  }
+
+  OAHTSlot* new_table = grow_table;
+  unsigned char* new_ctrl = grow_ctrl;
+  unsigned old_table_size = stats.TableSize_;
+  grow_table = 0;
+  grow_ctrl = 0;
+  BeginMigration(SwapTable(new_table, new_ctrl, grow_size), old_table_size);
+}
+
+/******************************************************************************
+ * @brief Helper function that pays for part of an in-flight resize: builds 
+ *  part of the next table, or moves part of the old one across
+ * 
+ * @tparam T 
+ *****************************************************************************/
+template<class T, class H, class K> void OAHashTable<T, H, K>::ResizeSome()
+{
+  if (grow_table)
+  {
+    InitSome(grow_batch);
+  }
+  else
+  {
+    MigrateSome(migrate_batch);
+  }
+}
+
+/******************************************************************************
+ * @brief Helper function that finishes an in-flight resize in one go, so 
+ *  every entry is in the current table afterwards
+ * 
+ * @tparam T 
+ *****************************************************************************/
+template<class T, class H, class K> void OAHashTable<T, H, K>::FinishResize()
+{
+  if (grow_table)
+  {
+    InitSome(grow_size);
+  }
+  if (migrate_table)
+  {
+    MigrateSome(migrate_size);
+  }
+}
+
+/******************************************************************************
+ * @brief Helper function for an incremental resize. Moves the next Buckets 
+ *  slots of the old table into the current one, leaving tombstones behind so 
+ *  probe sequences through the old table stay intact. Deletes the old table 
+ *  once it has been drained.
+ * 
+ * @tparam T 
+ * @param Buckets 
+ *****************************************************************************/
+template<class T, class H, class K> void 
+OAHashTable<T, H, K>::MigrateSome(unsigned Buckets)
+{
+  unsigned end = migrate_size - migrate_pos < Buckets ? migrate_size 
+                                                      : migrate_pos + Buckets;
+
+  for (; migrate_pos < end; ++migrate_pos)
+  {
+    OAHTSlot& slot = migrate_table[migrate_pos];
+    if (slot.State == OAHTSlot::OCCUPIED)
+    {
+      PlaceSlot(slot);
+      slot.State = OAHTSlot::DELETED;
+    }
+  }
+
+  if (migrate_pos == migrate_size)
+  {
+    FreeSlots(migrate_table, migrate_size);
+    migrate_table = 0;
+    UpdateMemory(0);
+  }
+}
+
+/******************************************************************************
+ * @brief Helper function that looks for Key in the old table of an 
+ *  incremental resize. Returns the index of its slot in that table, or 
+ *  OAHT_NPOS if it is not there.
+ * 
+ * @tparam T 
+ * @param Key 
+ * @param Info 
+ * @param Probes 
+ * @return unsigned 
+ *****************************************************************************/
+template<class T, class H, class K> unsigned 
+OAHashTable<T, H, K>::MigrateFindIndex(const char *Key, 
+  const OAHTKeyInfo &Info, unsigned &Probes) const
+{
+  // Info was computed for the current table size
+  unsigned PIndex = config.StoreHash_ ? HomeIndex(Info.Hash, migrate_size) 
+                            : hasher.Primary(Key, Info.Len, migrate_size);
+  unsigned SIndex = ProbeStep(Key, Info.Len, migrate_size);
+
+  unsigned index = PIndex;
+  for (unsigned i = 0; i < migrate_size; ++i)
+  {
+    const OAHTSlot& slot = migrate_table[index];
+    ++Probes;
+
+    if (slot.State == OAHTSlot::UNOCCUPIED)
+    {
+      break;
+    }
+
+    if (slot.State == OAHTSlot::OCCUPIED && KeyMatches(slot, Key, Info))
+    {
+      return index;
+    }
+
+    index = OAHTAdvance(index, SIndex, migrate_size);
+  }
+
+  return OAHT_NPOS;
+}
+
+/******************************************************************************
+ * @brief Robin Hood version of ProbeInsertIndex. Finds the first slot on the 
+ *  probe sequence that is empty or holds an entry closer to its home than 
+ *  the new one would be, and shifts the rest of the cluster forward one slot 
+ *  to make room there. Dist receives the new entry's distance from home. 
+ *  Returns OAHT_DUPLICATE if Key is already in the table; Key may be null 
+ *  when the entry is already known to be unique.
+ * 
+ * @tparam T 
+ * @param Key 
+ * @param Info 
+ * @param Dist 
+ * @return unsigned 
+ *****************************************************************************/
+template<class T, class H, class K> unsigned 
+OAHashTable<T, H, K>::RobinHoodIndex(const char *Key, 
+  const OAHTKeyInfo &Info, int &Dist)
+{
+  unsigned size = stats.TableSize_;
+  unsigned index = Info.Home;
+  Dist = 0;
+
+  for (;;)
+  {
+    ++stats.Probes_;
+
+    const OAHTSlot& slot = table[index];
+    if (slot.State != OAHTSlot::OCCUPIED || slot.probes < Dist)
+    {
+      break;
+    }
+
+    // Only entries with the same home can hold the same key
+    if (Key && slot.probes == Dist && KeyMatches(slot, Key, Info))
+    {
+      return OAHT_DUPLICATE;
+    }
+
+    index = OAHTAdvance(index, 1, size);
+    ++Dist;
+  }
+
+  if (table[index].State == OAHTSlot::OCCUPIED)
+  {
+    // Find the end of the cluster
+    unsigned end = index;
+    do
+    {
+      ++stats.Probes_;
+      end = OAHTAdvance(end, 1, size);
+    } while (table[end].State == OAHTSlot::OCCUPIED);
+
+    // Everything after the insertion point moves one slot further from home
+    for (unsigned j = end; j != index; )
+    {
+      unsigned prev = j ? j - 1 : size - 1;
+      table[j] = std::move(table[prev]);
+      ++table[j].probes;
+      if (ctrl)
+      {
+        SetCtrl(j, ctrl[prev]);
+      }
+      j = prev;
+    }
+  }
+
+  return index;
+}
+
 /******************************************************************************
- * @brief Construct a new OAHashTable<T>::OAHashTable object
+ * @brief Helper function that recomputes the heap memory held by the table 
+ *  (slots, control bytes, the old table of an incremental resize and the 
+ *  key arena's capacity) and raises the peak if needed. Transient is added 
+ *  for memory the table is about to free, such as the old slots while the 
+ *  table grows. A mapped snapshot lives in the page cache and is not 
+ *  counted.
  * 
  * @tparam T 
- * @param Config 
+ * @param Transient 
  *****************************************************************************/
-template<class T> OAHashTable<T>::
-OAHashTable(const OAHashTable<T>::OAHTConfig &Config)
-: config(Config)
+template<class T, class H, class K> void 
+OAHashTable<T, H, K>::UpdateMemory(unsigned long long Transient)
 {
-  try
+  unsigned long long bytes = Transient + arena.capacity();
+  if (!mapping)
   {
-    // Make the initial table
-    table = new OAHTSlot[config.InitialTableSize_];
+    bytes += static_cast<unsigned long long>(stats.TableSize_) * 
+      sizeof(OAHTSlot);
+    if (ctrl)
+    {
+      bytes += stats.TableSize_ + GROUP_WIDTH - 1;
+    }
   }
-  catch(const std::bad_alloc&)
+  if (migrate_table)
   {
-    throw (OAHashTableException(OAHashTableException::E_NO_MEMORY,
-      "The table does not have enough memory"));
+    bytes += static_cast<unsigned long long>(migrate_size) * sizeof(OAHTSlot);
+  }
+  if (grow_table)
+  {
+    bytes += static_cast<unsigned long long>(grow_size) * sizeof(OAHTSlot);
+    if (grow_ctrl)
+    {
+      bytes += grow_size + GROUP_WIDTH - 1;
+    }
   }
 
-  InitTable();
+  stats.Bytes_ = bytes;
+  if (bytes > stats.PeakBytes_)
+  {
+    stats.PeakBytes_ = bytes;
+  }
 }
 
 /******************************************************************************
- * @brief Destroy the OAHashTable<T>::OAHashTable object
+ * @brief Helper function that adds one operation's probe count to the 
+ *  histogram
  * 
  * @tparam T 
+ * @param Probes 
  *****************************************************************************/
-template<class T> OAHashTable<T>::~OAHashTable()
+template<class T, class H, class K> void 
+OAHashTable<T, H, K>::RecordProbeLength(unsigned Probes) const
 {
-  // Clear the table
-  clear();
-
-  // Delete the table
-  delete [] table;
+  ++stats.ProbeHistogram_[OAHTProbeBucket(Probes)];
 }
 
 /******************************************************************************
- * @brief Inserts a Key/Data pair into the table. Throws an exception if the 
- * data cannot be inserted. (E_DUPLICATE, E_NO_MEMORY)
+ * @brief Helper function that readies the table for Count more entries: 
+ *  copies a loaded snapshot out of its mapping, pays for part of an 
+ *  in-flight resize and grows the table until they fit under the load 
+ *  factor.
  * 
  * @tparam T 
- * @param Key 
- * @param Data 
+ * @param Count 
  *****************************************************************************/
-template<class T> void OAHashTable<T>::insert(const char *Key, const T &Data)
+template<class T, class H, class K> void 
+OAHashTable<T, H, K>::PrepareInsert(unsigned Count)
 {
-  if (((stats.Count_ + 1) / static_cast<double>(stats.TableSize_)) 
+  // Snapshots are copied out on the first write
+  if (mapping)
+  {
+    Promote();
+  }
+
+  // Pay for part of an in-flight resize
+  if (grow_table || migrate_table)
+  {
+    ResizeSome();
+  }
+
+  while (((stats.Count_ + Count) / static_cast<double>(stats.TableSize_)) 
   > config.MaxLoadFactor_)
   {
+    // While the next table is being built the current one may go past its 
+    // load factor, up to the limit set when the build started
+    if (grow_table)
+    {
+      if (stats.Count_ + Count <= grow_limit)
+      {
+        break;
+      }
+      FinishResize();
+      continue;
+    }
+
     GrowTable();
   }
+}
 
-  // Place in hash table where this will be inserted
-  unsigned PIndex = config.PrimaryHashFunc_(Key, stats.TableSize_);
+/******************************************************************************
+ * @brief Helper function that grows the table in a single step so Count 
+ *  more entries fit under the load factor. An in-flight resize is finished 
+ *  first, since bulk placement needs every entry in the current table.
+ * 
+ * @tparam T 
+ * @param Count 
+ *****************************************************************************/
+template<class T, class H, class K> void 
+OAHashTable<T, H, K>::ReserveTable(unsigned Count)
+{
+  if (grow_table || migrate_table)
+  {
+    FinishResize();
+  }
 
-  // Increment probe counter for initally finding place
-  // in hash table
-  ++stats.Probes_;
+  double needed = std::ceil((stats.Count_ + static_cast<double>(Count)) / 
+    config.MaxLoadFactor_);
+  if (needed <= stats.TableSize_)
+  {
+    return;
+  }
 
-  // If collision occurs
-  if (table[PIndex].State == OAHTSlot::OCCUPIED)
+  // Drop the bytes of removed keys once they outweigh the live ones
+  if (config.ArenaKeys_ && arena_garbage > arena.size() - arena_garbage)
   {
-    if (strncmp(Key, table[PIndex].Key, MAX_KEYLEN) == 0)
-    {
-      throw (OAHashTableException(OAHashTableException::E_DUPLICATE,
-      "Item being inserted is a duplicate"));
-    }
+    CompactArena();
+  }
 
-    // Get Sindex from secondary hash function
-    unsigned SIndex = 1;
-    if (config.SecondaryHashFunc_)
-    {
-      SIndex = config.SecondaryHashFunc_(Key, stats.TableSize_ - 1) + 1;
-    }
-    unsigned i = 1;
-    unsigned targetIndex = 0;
-    bool foundDeleted = false;
+  unsigned old_table_size = stats.TableSize_;
+  unsigned new_table_size;
+  if (config.CapacityPolicy_ == OAHTCapacityPolicy::POWER_OF_TWO)
+  {
+    new_table_size = OAHTPowerOfTwo(static_cast<unsigned>(needed));
+  }
+  else
+  {
+    new_table_size = GetClosestPrime(static_cast<unsigned>(needed));
+  }
 
-    for (; i < stats.TableSize_; ++i)
-    {
-      // Increment probe counter
-      ++stats.Probes_;
+  OAHTSlot* old_table = ReplaceTable(new_table_size);
+  ++stats.Expansions_;
+  MoveSlots(old_table, old_table_size);
+}
 
-      // Get newIndex
-      unsigned newIndex = (PIndex + i * SIndex) % stats.TableSize_;
+/******************************************************************************
+ * @brief Helper function that claims a slot for a key that has already been 
+ *  hashed for the current table size and fills in everything but the data, 
+ *  which the caller stores. Returns the slot's index, or OAHT_DUPLICATE 
+ *  (leaving the table unchanged) if Key is already in the table.
+ * 
+ * @tparam T 
+ * @param Key 
+ * @param Info 
+ * @return unsigned 
+ *****************************************************************************/
+template<class T, class H, class K> unsigned 
+OAHashTable<T, H, K>::ClaimSlot(const char *Key, 
+  const OAHTKeyInfo &Info)
+{
+  unsigned start = stats.Probes_;
+  int dist = 0;
+  unsigned PIndex;
 
-      // If duplicate is found, throw exception
-      if (table[newIndex].State == OAHTSlot::OCCUPIED && strncmp(Key, table[newIndex].Key, MAX_KEYLEN) == 0)
-      {
-        throw (OAHashTableException(OAHashTableException::E_DUPLICATE,
-        "Item being inserted is a duplicate"));
-      }
+  // Keys that have not been migrated yet are still in the old table
+  if (migrate_table && 
+    MigrateFindIndex(Key, Info, stats.Probes_) != OAHT_NPOS)
+  {
+    PIndex = OAHT_DUPLICATE;
+  }
+  else if (config.DeletionPolicy_ == OAHTDeletionPolicy::ROBINHOOD)
+  {
+    PIndex = RobinHoodIndex(Key, Info, dist);
+  }
+  else
+  {
+    PIndex = config.ControlBytes_ ? CtrlInsertIndex(Key, Info) 
+                                  : ProbeInsertIndex(Key, Info);
+  }
 
-      // Keep track of the first deleted slot
-      if (table[newIndex].State == OAHTSlot::DELETED && !foundDeleted)
-      {
-        targetIndex = newIndex;
-        foundDeleted = true;
-      }
+  RecordProbeLength(stats.Probes_ - start);
+  if (PIndex == OAHT_DUPLICATE)
+  {
+    return PIndex;
+  }
 
-      // If no collision occurs, store the slot
-      if (table[newIndex].State == OAHTSlot::UNOCCUPIED)
-      {
-        // If there was a deleted slot, insert the key there
-        if (!foundDeleted)
-        {
-          targetIndex = newIndex;
-        }
-        break;
-      }
-    }
-    PIndex = targetIndex;
+  // Reusing a deleted slot retires its tombstone
+  if (table[PIndex].State == OAHTSlot::DELETED)
+  {
+    --stats.Tombstones_;
   }
 
-  if (table[PIndex].Key != Key)
+  // Arena keys are only kept in the arena
+  if (config.ArenaKeys_)
+  {
+    table[PIndex].KeyOffset = static_cast<unsigned>(arena.size());
+    arena.insert(arena.end(), Key, Key + Info.Len);
+    arena.push_back('\0');
+    UpdateMemory(0);
+  }
+  else if constexpr (!K::Arena)
   {
-    strncpy(table[PIndex].Key, Key, MAX_KEYLEN - 1);
+    // Stored keys stay null-terminated for the user's hash functions
+    if (table[PIndex].Key != Key)
+    {
+      memcpy(table[PIndex].Key, Key, Info.Len);
+    }
+    table[PIndex].Key[Info.Len] = '\0';
   }
-  table[PIndex].Data = Data;
+
   table[PIndex].State = OAHTSlot::OCCUPIED;
-  //table[PIndex].probes = stats.Probes_;
+  table[PIndex].Hash = Info.Hash;
+  table[PIndex].Len = Info.Len;
+  table[PIndex].probes = dist;
+  if (ctrl)
+  {
+    SetCtrl(PIndex, Info.Tag);
+  }
 
   ++stats.Count_;
+  return PIndex;
 }
 
 /******************************************************************************
- * @brief Removes a Key/Data pair by key. Throws an exception if the pair 
- * cannot be removed. (E_ITEM_NOT_FOUND)
+ * @brief Helper function behind both versions of remove. Removes the pair 
+ *  whose key is the first Length bytes of Key. Throws an exception if the 
+ *  pair cannot be removed. (E_ITEM_NOT_FOUND)
  * 
  * @tparam T 
  * @param Key 
+ * @param Length 
  *****************************************************************************/
-template<class T> void OAHashTable<T>::remove(const char *Key)
+template<class T, class H, class K> void 
+OAHashTable<T, H, K>::RemoveKey(const char *Key, unsigned Length)
 {
-  // Initialize indices
-  unsigned PIndex = stats.PrimaryHashFunc_(Key, stats.TableSize_);
-  unsigned SIndex = 1;
-  if (stats.SecondaryHashFunc_)
+  // Snapshots are copied out on the first write
+  if (mapping)
   {
-    SIndex = stats.SecondaryHashFunc_(Key, stats.TableSize_ - 1) + 1;
+    Promote();
   }
-  unsigned i = 0;
 
-  // Walk through the table until the end of the cluster is reached
-  for (; i < stats.TableSize_; ++i)
+  // Pay for part of an in-flight resize
+  if (grow_table || migrate_table)
   {
-    OAHTSlot& slot = table[(PIndex + i * SIndex) % stats.TableSize_];
-
-    ++stats.Probes_;
+    ResizeSome();
+  }
 
-    if (slot.State == OAHTSlot::UNOCCUPIED)
-    {
-      break;
-    }
+  OAHTKeyInfo info = HashKey(Key, Length);
+  unsigned start = stats.Probes_;
+  unsigned index = config.ControlBytes_ 
+    ? CtrlFindIndex(Key, info, stats.Probes_) 
+    : ProbeFindIndex(Key, info, stats.Probes_);
 
-    // If the key is found
-    if (slot.State == OAHTSlot::OCCUPIED && strncmp(Key, slot.Key, MAX_KEYLEN) == 0)
+  // The old table is being drained, so a tombstone is all it needs
+  if (index == OAHT_NPOS && migrate_table)
+  {
+    index = MigrateFindIndex(Key, info, stats.Probes_);
+    RecordProbeLength(stats.Probes_ - start);
+    if (index != OAHT_NPOS)
     {
       --stats.Count_;
-
-      if (config.FreeProc_)
-      {
-        config.FreeProc_(slot.Data);
-      }
-
-      if (config.DeletionPolicy_ == OAHTDeletionPolicy::MARK)
+      if (config.ArenaKeys_)
       {
-        slot.State = OAHTSlot::DELETED;
+        arena_garbage += migrate_table[index].Len + 1;
       }
-      else // PACK
+      if (config.FreeProc_)
       {
-        slot.State = OAHTSlot::UNOCCUPIED;
-        // Compress the table
-        for (unsigned j = 1; j < stats.TableSize_; ++j) {
-          OAHTSlot& slot2 = table[(PIndex + (i + j) * SIndex) % stats.TableSize_];
-          if (slot2.State == OAHTSlot::OCCUPIED)
-          {
-            slot2.State = OAHTSlot::UNOCCUPIED;
-            --stats.Count_;
-            insert(slot2.Key, slot2.Data);
-          }
-          else 
-          {
-            break;
-          }
-        }
+        config.FreeProc_(migrate_table[index].Data);
       }
+      migrate_table[index].State = OAHTSlot::DELETED;
       return;
     }
   }
 
-  // If we made it to this point, then the item was not found
-  throw(OAHashTableException(OAHashTableException::E_ITEM_NOT_FOUND,
-    "Key not in table."));
-}
+  else
+  {
+    RecordProbeLength(stats.Probes_ - start);
+  }
 
-/******************************************************************************
- * @brief Finds the data by key and returns a reference to the constant data. 
- * Throws an exception if Key isn't found. (E_ITEM_NOT_FOUND)
- * 
- * @tparam T 
- * @param Key 
- * @return const T& 
- *****************************************************************************/
-template<class T> const T &OAHashTable<T>::find(const char *Key) const
-{
-  // Initialize indices
-  unsigned PIndex = stats.PrimaryHashFunc_(Key, stats.TableSize_);
-  unsigned SIndex = 1;
-  if (stats.SecondaryHashFunc_)
+  // If the index is invalid, then the item was not found
+  if (index == OAHT_NPOS)
   {
-    SIndex = stats.SecondaryHashFunc_(Key, stats.TableSize_ - 1) + 1;
+    throw(OAHashTableException(OAHashTableException::E_ITEM_NOT_FOUND,
+      "Key not in table."));
   }
 
-  unsigned i;
+  OAHTSlot& slot = table[index];
+  --stats.Count_;
 
-  // Walk through the table until the key is found
-  //for (unsigned i = PIndex; ; i = (i + SIndex) % stats.TableSize_)
-  for (i = 0; i < stats.TableSize_; ++i)
+  // The key's bytes stay in the arena until it is compacted
+  if (config.ArenaKeys_)
   {
-    OAHTSlot& slot = table[(PIndex + i * SIndex) % stats.TableSize_];
-    ++stats.Probes_;
-    if (slot.State == OAHTSlot::OCCUPIED && strncmp(Key, slot.Key, MAX_KEYLEN) == 0)
+    arena_garbage += slot.Len + 1;
+  }
+
+  if (config.FreeProc_)
+  {
+    config.FreeProc_(slot.Data);
+  }
+
+  if (config.DeletionPolicy_ == OAHTDeletionPolicy::MARK)
+  {
+    slot.State = OAHTSlot::DELETED;
+    if (ctrl)
     {
-      return slot.Data;
+      SetCtrl(index, CTRL_DELETED);
     }
 
-    // If the slot is unoccupied, then the item does not exist
-    if (slot.State == OAHTSlot::UNOCCUPIED)
+    // Rebuild once tombstones make up too much of the table
+    ++stats.Tombstones_;
+    if (config.MaxTombstoneRatio_ > 0.0 && stats.Tombstones_ > 
+      config.MaxTombstoneRatio_ * stats.TableSize_)
     {
-      break;
+      CompactTable();
     }
   }
+  else if (config.DeletionPolicy_ == OAHTDeletionPolicy::ROBINHOOD)
+  {
+    // Shift the rest of the cluster back one slot until an entry that is 
+    // already in its home slot (or an empty slot) is reached
+    unsigned hole = index;
+    unsigned next = OAHTAdvance(index, 1, stats.TableSize_);
+    while (table[next].State == OAHTSlot::OCCUPIED && table[next].probes > 0)
+    {
+      table[hole] = std::move(table[next]);
+      --table[hole].probes;
+      if (ctrl)
+      {
+        SetCtrl(hole, ctrl[next]);
+      }
+      hole = next;
+      next = OAHTAdvance(next, 1, stats.TableSize_);
+    }
 
-  throw(OAHashTableException(OAHashTableException::E_ITEM_NOT_FOUND,
-    "Item not found in table."));
-}
-
-/******************************************************************************
- * @brief Removes all Key/Data pairs in the table, freeing the data if 
- * necessary. This does not free the hash table itself. If a FreeProc was 
- * provided, you must pass the data in each slot to that function and then 
- * set the slot as unoccupied.
- * 
- * @tparam T 
- *****************************************************************************/
-template<class T> void OAHashTable<T>::clear()
-{
-  for (unsigned i = 0; i < stats.TableSize_; ++i)
+    table[hole].State = OAHTSlot::UNOCCUPIED;
+    if (ctrl)
+    {
+      SetCtrl(hole, CTRL_EMPTY);
+    }
+  }
+  else // PACK
   {
-    if(config.FreeProc_ && table[i].State == OAHTSlot::OCCUPIED)
+    slot.State = OAHTSlot::UNOCCUPIED;
+    if (ctrl)
     {
-      config.FreeProc_(table[i].Data);
+      SetCtrl(index, CTRL_EMPTY);
+    }
+
+    // Compress the table
+    unsigned index2 = index;
+    for (unsigned j = 1; j < stats.TableSize_; ++j) {
+      index2 = OAHTAdvance(index2, info.Step, stats.TableSize_);
+      OAHTSlot& slot2 = table[index2];
+      if (slot2.State == OAHTSlot::OCCUPIED)
+      {
+        slot2.State = OAHTSlot::UNOCCUPIED;
+        if (ctrl)
+        {
+          SetCtrl(index2, CTRL_EMPTY);
+        }
+
+        // Already known to be unique, so it only needs a new home
+        PlaceSlot(slot2);
+      }
+      else 
+      {
+        break;
+      }
     }
-    table[i].State = OAHTSlot::UNOCCUPIED;
-    //table[i].probes = 0;
   }
-  stats.Count_ = 0;
 }
 
 /******************************************************************************
- * @brief Returns a struct that contains information on the status of the 
- * table for debugging and testing. The struct is defined in the header file.
+ * @brief Helper function that looks up a key that has already been hashed 
+ *  for the current table size. Returns a pointer to its data or null.
  * 
  * @tparam T 
- * @return OAHTStats 
+ * @param Key 
+ * @param Info 
+ * @param Probes 
+ * @return const T* 
  *****************************************************************************/
-template<class T> OAHTStats OAHashTable<T>::GetStats() const
+template<class T, class H, class K> const T* 
+OAHashTable<T, H, K>::LookupHashed(const char *Key, 
+  const OAHTKeyInfo &Info, unsigned &Probes) const
 {
-  return stats;
-}
+  unsigned index = config.ControlBytes_ ? CtrlFindIndex(Key, Info, Probes) 
+                                        : ProbeFindIndex(Key, Info, Probes);
+  if (index != OAHT_NPOS)
+  {
+    return &table[index].Data;
+  }
 
-/******************************************************************************
- * @brief Get the table
- * 
- * @tparam T 
- * @return const OAHashTable<T>::OAHTSlot* 
- *****************************************************************************/
-template<class T> const typename OAHashTable<T>::OAHTSlot* 
-OAHashTable<T>::GetTable() const
-{
-  return table;
-}
+  // Check the old table while a resize is in flight
+  if (migrate_table)
+  {
+    index = MigrateFindIndex(Key, Info, Probes);
+    if (index != OAHT_NPOS)
+    {
+      return &migrate_table[index].Data;
+    }
+  }
 
-///////////////////////////////////////////////////////////////////////////////
-//--  HELPER FUNCTIONS  --/////////////////////////////////////////////////////
-///////////////////////////////////////////////////////////////////////////////
+  return 0;
+}
 
 /******************************************************************************
- * @brief Helper function for initializing a table when it gets made
+ * @brief Helper function that looks up a hashed key and adds the probes to 
+ *  the table's stats. Returns a pointer to its data or null.
  * 
  * @tparam T 
+ * @param Key 
+ * @param Info 
+ * @return const T* 
  *****************************************************************************/
-template<class T> void OAHashTable<T>::InitTable()
+template<class T, class H, class K> const T* 
+OAHashTable<T, H, K>::FindKey(const char *Key, 
+  const OAHTKeyInfo &Info) const
 {
-  // Initialize table
-  for (unsigned i = 0; i < config.InitialTableSize_; ++i)
-  {
-    table[i].State = OAHTSlot::UNOCCUPIED;
-    table[i].probes = 0;
-  }
+  unsigned probes = 0;
+  const T *data = LookupHashed(Key, Info, probes);
+  stats.Probes_ += probes;
+  RecordProbeLength(probes);
 
-  // Store the initial stats from config
-  stats.TableSize_ = config.InitialTableSize_;
-  stats.Probes_ = 0;
-  stats.Expansions_ = 0;
-  stats.Count_ = 0;
-  stats.PrimaryHashFunc_ = config.PrimaryHashFunc_;
-  stats.SecondaryHashFunc_ = config.SecondaryHashFunc_;
+  return data;
 }
 
 /******************************************************************************
- * @brief Helper function for growing a table
+ * @brief Helper function that starts loading the first slot (and control 
+ *  bytes) a lookup of an already-hashed key will touch.
  * 
  * @tparam T 
+ * @param Info 
  *****************************************************************************/
-template<class T> void OAHashTable<T>::GrowTable()
+template<class T, class H, class K> void 
+OAHashTable<T, H, K>::PrefetchHome(const OAHTKeyInfo &Info) const
 {
-  // Record old table size
-  unsigned old_table_size = stats.TableSize_;
-
-  // Calculate new table size
-  double factor = std::ceil(stats.TableSize_ * config.GrowthFactor_);
-  unsigned new_table_size = GetClosestPrime(static_cast<unsigned>(factor));
-  stats.TableSize_ = new_table_size;
-
-  // Make the new table
-  OAHTSlot* old_table = table;
-  try
-  {
-    table = new OAHTSlot[stats.TableSize_];
-  }
-  catch(const std::bad_alloc&)
-  {
-    throw (OAHashTableException(OAHashTableException::E_NO_MEMORY,
-      "The table does not have enough memory"));
-  }
-  
-  stats.Count_ = 0;
-
-  // Initialize table
-  for (unsigned i = 0; i < stats.TableSize_; ++i)
-  {
-    table[i].State = OAHTSlot::UNOCCUPIED;
-    table[i].probes = 0;
-  }
-
-  // Move slots over
-  for (unsigned i = 0; i < old_table_size; ++i)
+  OAHTPrefetch(&table[Info.Home]);
+  if (ctrl)
   {
-    if (old_table[i].State == OAHTSlot::OCCUPIED)
-    {
-      insert(old_table[i].Key, old_table[i].Data);
-    }
+    OAHTPrefetch(ctrl + Info.Home);
   }
-
-  // Delete the old table and set the new one
-  delete [] old_table;
-  ++stats.Expansions_;
-}
\ No newline at end of file
+}
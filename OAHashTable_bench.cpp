@@ -0,0 +1,1161 @@
+/******************************************************************************
+ * @file OAHashTable_bench.cpp
+ * @author Jay Sharma
+ * @brief Single-threaded benchmark for OAHashTable. Sweeps MaxLoadFactor_,
+ *  GrowthFactor_, MARK and PACK deletion and a secondary hash function over
+ *  uniform, Zipfian and shared-prefix key sets, and times a build followed
+ *  by several find/insert/remove mixes. A std::unordered_map with the same
+ *  maximum load factor is the baseline. Prints one CSV row per run with
+ *  ns/op, probes/op and peak bytes.
+ * 
+ *  After the sweep come the comparisons for single features, in the same
+ *  columns with the variant in the table column: plain slots against
+ *  ControlBytes_, find_many and insert_many batches of 1 to 64 against a
+ *  loop of single calls on a table larger than the last-level cache, prime
+ *  against power-of-two capacity, the throwing API against try_find, 
+ *  try_insert and emplace, and the built-in hash policies against the 
+ *  function pointers.
+ * 
+ *  Given a CSV from an earlier run, it also compares every OAHashTable row
+ *  against it and exits non-zero if probes/op or peak bytes went up, or if
+ *  ns/op went up by more than the allowed percentage when one is given.
+ *  Probes and bytes do not depend on the machine, so they can gate changes
+ *  anywhere; timings only mean something on the machine that made the
+ *  baseline.
+ * 
+ *  Usage: OAHashTable_bench [keys] [ops] [baseline csv] [max slowdown %]
+ * @version 0.1
+ * @date 2026-10-16
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ *****************************************************************************/
+
+#include "OAHashTable.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Zipf exponent for the skewed key set
+static const double ZIPF_SKEW = 0.99;
+
+// Percentage of operations that are finds, for each mix. The rest are
+// split between inserts and removes.
+static const unsigned READ_MIXES[] = {100, 90, 50};
+
+// Table settings swept for every key set
+static const double LOAD_FACTORS[] = {0.5, 0.7, 0.9};
+static const double GROWTH_FACTORS[] = {1.5, 2.0};
+
+// Each run is repeated and the fastest time kept, to keep noise out of the
+// regression gate
+static const unsigned REPEATS = 3;
+
+// Growth in probes/op or peak bytes the gate allows for rounding, as a
+// fraction
+static const double COUNT_TOLERANCE = 0.01;
+
+// The batch tables get this many times as many keys as the others, 8M by 
+// default, so their slots (a few hundred MB) do not fit in the last-level 
+// cache and every home slot is a miss
+static const unsigned BATCH_KEY_SCALE = 32;
+
+// Batch sizes for find_many and insert_many
+static const unsigned BATCH_SIZES[] = {1, 2, 4, 8, 16, 32, 64};
+
+// Share of lookups that miss in the miss-heavy comparison, in percent
+static const unsigned MISS_PERCENT = 90;
+
+// Length of the std::string data the emplace comparison builds
+static const unsigned STRING_DATA_LENGTH = 40;
+
+// Bytes currently and at most allocated by the baseline's allocator
+static long long baseline_bytes = 0;
+static long long baseline_peak = 0;
+
+// One operation of a mix: which key, and what to do with it
+struct BenchOp
+{
+  unsigned Key_;
+  enum BenchOpType {FIND, INSERT, REMOVE} Type_;
+};
+
+// One printed result. Config_ holds every column before the measurements
+// and is what rows are matched on when comparing against a baseline.
+struct BenchRow
+{
+  std::string Config_;
+  double NsPerOp_;
+  double ProbesPerOp_;
+  long long PeakBytes_;
+};
+
+/******************************************************************************
+ * @brief Allocator that counts the bytes the baseline holds, so its peak
+ *  memory can be compared with OAHTStats::PeakBytes_
+ * 
+ * @tparam U 
+ *****************************************************************************/
+template<class U> struct CountingAllocator
+{
+  typedef U value_type;
+
+  CountingAllocator() {}
+  template<class V> CountingAllocator(const CountingAllocator<V> &) {}
+
+  U *allocate(size_t Count)
+  {
+    baseline_bytes += static_cast<long long>(Count * sizeof(U));
+    baseline_peak = std::max(baseline_peak, baseline_bytes);
+    return std::allocator<U>().allocate(Count);
+  }
+
+  void deallocate(U *Pointer, size_t Count)
+  {
+    baseline_bytes -= static_cast<long long>(Count * sizeof(U));
+    std::allocator<U>().deallocate(Pointer, Count);
+  }
+
+  template<class V> bool operator==(const CountingAllocator<V> &) const
+  {
+    return true;
+  }
+  template<class V> bool operator!=(const CountingAllocator<V> &) const
+  {
+    return false;
+  }
+};
+
+// Baseline keys allocate through the counter too, like the table's arena
+typedef std::basic_string<char, std::char_traits<char>,
+  CountingAllocator<char>> BaselineKey;
+
+/******************************************************************************
+ * @brief Hashes a baseline key the way std::hash<std::string> would
+ *****************************************************************************/
+struct BaselineHash
+{
+  size_t operator()(const BaselineKey &Key) const
+  {
+    return std::hash<std::string_view>()(
+      std::string_view(Key.data(), Key.size()));
+  }
+};
+
+typedef std::unordered_map<BaselineKey, unsigned, BaselineHash,
+  std::equal_to<BaselineKey>,
+  CountingAllocator<std::pair<const BaselineKey, unsigned>>> BaselineMap;
+
+/******************************************************************************
+ * @brief FNV-1a, used as the primary hash function
+ * 
+ * @param Key 
+ * @param TableSize 
+ * @return unsigned 
+ *****************************************************************************/
+static unsigned FNVHash(const char *Key, unsigned TableSize)
+{
+  unsigned hash = 2166136261u;
+  for (; *Key; ++Key)
+  {
+    hash = (hash ^ static_cast<unsigned char>(*Key)) * 16777619u;
+  }
+  return hash % TableSize;
+}
+
+/******************************************************************************
+ * @brief djb2, used as the secondary hash function. It has to be unrelated
+ *  to the primary one or double hashing gains nothing.
+ * 
+ * @param Key 
+ * @param TableSize 
+ * @return unsigned 
+ *****************************************************************************/
+static unsigned DJBHash(const char *Key, unsigned TableSize)
+{
+  unsigned hash = 5381;
+  for (; *Key; ++Key)
+  {
+    hash = hash * 33 + static_cast<unsigned char>(*Key);
+  }
+  return hash % TableSize;
+}
+
+/******************************************************************************
+ * @brief Makes Count distinct keys. Short keys are scrambled numbers in hex, 
+ *  at most 8 bytes, so they fit in a plain slot; shared-prefix keys all 
+ *  start with the same 24 bytes, which is what a hash that only mixes the 
+ *  first few bytes gets wrong.
+ * 
+ * @param Count 
+ * @param SharedPrefix 
+ * @return std::vector<std::string> 
+ *****************************************************************************/
+static std::vector<std::string> MakeKeys(unsigned Count, bool SharedPrefix)
+{
+  std::vector<std::string> keys(Count);
+  for (unsigned i = 0; i < Count; ++i)
+  {
+    char key[16];
+    std::snprintf(key, sizeof(key), "%x", i * 2654435761u);
+    keys[i] = key;
+    if (SharedPrefix)
+    {
+      keys[i] = "tenant/eu-west/sessions/" + keys[i];
+    }
+  }
+  return keys;
+}
+
+/******************************************************************************
+ * @brief Makes Count distinct decimal ID keys, the input OAHTIntegerHash is 
+ *  built for
+ * 
+ * @param Count 
+ * @return std::vector<std::string> 
+ *****************************************************************************/
+static std::vector<std::string> MakeIds(unsigned Count)
+{
+  std::vector<std::string> keys(Count);
+  for (unsigned i = 0; i < Count; ++i)
+  {
+    keys[i] = std::to_string(i * 2654435761u);
+  }
+  return keys;
+}
+
+/******************************************************************************
+ * @brief Draws key indices in [0, Count), either uniformly or with Zipfian
+ *  popularity (rank r has weight 1 / r^ZIPF_SKEW)
+ *****************************************************************************/
+class KeyPicker
+{
+  public:
+    KeyPicker(unsigned Count, bool Zipf) : count(Count), zipf(Zipf)
+    {
+      if (zipf)
+      {
+        cdf.resize(count);
+        double sum = 0.0;
+        for (unsigned i = 0; i < count; ++i)
+        {
+          sum += 1.0 / std::pow(i + 1.0, ZIPF_SKEW);
+          cdf[i] = sum;
+        }
+        for (double& c : cdf)
+        {
+          c /= sum;
+        }
+      }
+    }
+
+    unsigned operator()(std::mt19937 &Rng) const
+    {
+      if (!zipf)
+      {
+        return Rng() % count;
+      }
+
+      double u = std::uniform_real_distribution<double>(0.0, 1.0)(Rng);
+      unsigned rank = static_cast<unsigned>(
+        std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin());
+      return rank < count ? rank : count - 1;
+    }
+
+  private:
+    unsigned count;
+    bool zipf;
+    std::vector<double> cdf;
+};
+
+/******************************************************************************
+ * @brief Builds the operations of one mix up front, so random number
+ *  generation is not timed. The even keys are present when the mix starts.
+ *  Which keys are present is tracked, so every insert adds a key and every
+ *  remove takes one away; no write fails, and the table stays near its
+ *  starting size.
+ * 
+ * @param Ops 
+ * @param ReadPercent 
+ * @param Picker 
+ * @param Count // number of keys 
+ * @return std::vector<BenchOp> 
+ *****************************************************************************/
+static std::vector<BenchOp> MakeOps(unsigned Ops, unsigned ReadPercent,
+  const KeyPicker &Picker, unsigned Count)
+{
+  std::mt19937 rng(ReadPercent);
+  std::vector<bool> present(Count);
+  for (unsigned i = 0; i < Count; i += 2)
+  {
+    present[i] = true;
+  }
+
+  std::vector<BenchOp> ops(Ops);
+  for (BenchOp& op : ops)
+  {
+    op.Key_ = Picker(rng);
+    if (rng() % 100 < ReadPercent)
+    {
+      op.Type_ = BenchOp::FIND;
+      continue;
+    }
+
+    op.Type_ = present[op.Key_] ? BenchOp::REMOVE : BenchOp::INSERT;
+    present[op.Key_] = !present[op.Key_];
+  }
+  return ops;
+}
+
+/******************************************************************************
+ * @brief Returns the time since Start in nanoseconds
+ * 
+ * @param Start 
+ * @return double 
+ *****************************************************************************/
+static double ElapsedNs(std::chrono::steady_clock::time_point Start)
+{
+  return std::chrono::duration<double, std::nano>(
+    std::chrono::steady_clock::now() - Start).count();
+}
+
+/******************************************************************************
+ * @brief Records one timed run in a row. The fastest run is kept; probes 
+ *  do not change between runs.
+ * 
+ * @param Row 
+ * @param Ns // time of the whole run 
+ * @param Probes // probes of the whole run 
+ * @param Ops 
+ *****************************************************************************/
+static void Record(BenchRow &Row, double Ns, unsigned Probes, size_t Ops)
+{
+  Row.NsPerOp_ = std::min(Row.NsPerOp_, Ns / Ops);
+  Row.ProbesPerOp_ = static_cast<double>(Probes) / Ops;
+}
+
+/******************************************************************************
+ * @brief Times one configuration of OAHashTable: inserts the even keys into
+ *  an empty table, then runs each mix. Fills in one row per phase, keeping
+ *  the fastest of REPEATS runs.
+ * 
+ * @param Config 
+ * @param Keys 
+ * @param Mixes 
+ * @param Rows // one row per phase, measurements only 
+ *****************************************************************************/
+static void RunTable(const OAHashTable<unsigned>::OAHTConfig &Config,
+  const std::vector<std::string> &Keys,
+  const std::vector<std::vector<BenchOp>> &Mixes, std::vector<BenchRow> &Rows)
+{
+  for (unsigned repeat = 0; repeat < REPEATS; ++repeat)
+  {
+    OAHashTable<unsigned> table(Config);
+    unsigned long long sum = 0;
+
+    unsigned probes = table.GetStats().Probes_;
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < Keys.size(); i += 2)
+    {
+      table.insert(Keys[i].c_str(), i);
+    }
+    Record(Rows[0], ElapsedNs(start), table.GetStats().Probes_ - probes,
+      (Keys.size() + 1) / 2);
+
+    for (unsigned m = 0; m < Mixes.size(); ++m)
+    {
+      probes = table.GetStats().Probes_;
+      start = std::chrono::steady_clock::now();
+      for (const BenchOp& op : Mixes[m])
+      {
+        const char *key = Keys[op.Key_].c_str();
+        if (op.Type_ == BenchOp::FIND)
+        {
+          const unsigned *data = table.try_find(key);
+          sum += data ? *data : 0;
+        }
+        else if (op.Type_ == BenchOp::INSERT)
+        {
+          table.insert(key, op.Key_);
+        }
+        else
+        {
+          table.remove(key);
+        }
+      }
+      Record(Rows[m + 1], ElapsedNs(start), table.GetStats().Probes_ - probes,
+        Mixes[m].size());
+
+      // Undo the mix so the next one starts from the even keys again
+      for (unsigned i = 0; i < Keys.size(); ++i)
+      {
+        if (i % 2 == 0)
+        {
+          table.try_insert(Keys[i].c_str(), i);
+        }
+        else if (table.try_find(Keys[i].c_str()))
+        {
+          table.remove(Keys[i].c_str());
+        }
+      }
+    }
+
+    // The peak covers every phase, so it is the same for each row
+    for (BenchRow& row : Rows)
+    {
+      row.PeakBytes_ = static_cast<long long>(table.GetStats().PeakBytes_);
+    }
+
+    // Keep the work from being optimized away
+    if (sum == 1)
+    {
+      std::printf("#\n");
+    }
+  }
+}
+
+/******************************************************************************
+ * @brief Times the std::unordered_map baseline the same way as RunTable.
+ *  Probes are not counted for it.
+ * 
+ * @param MaxLoadFactor 
+ * @param Keys 
+ * @param Mixes 
+ * @param Rows // one row per phase, measurements only 
+ *****************************************************************************/
+static void RunBaseline(double MaxLoadFactor,
+  const std::vector<BaselineKey> &Keys,
+  const std::vector<std::vector<BenchOp>> &Mixes, std::vector<BenchRow> &Rows)
+{
+  for (unsigned repeat = 0; repeat < REPEATS; ++repeat)
+  {
+    baseline_bytes = 0;
+    baseline_peak = 0;
+    BaselineMap table;
+    table.max_load_factor(static_cast<float>(MaxLoadFactor));
+    unsigned long long sum = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < Keys.size(); i += 2)
+    {
+      table.emplace(Keys[i], i);
+    }
+    double ns = ElapsedNs(start);
+    unsigned builds = static_cast<unsigned>((Keys.size() + 1) / 2);
+    Rows[0].NsPerOp_ = std::min(Rows[0].NsPerOp_, ns / builds);
+
+    for (unsigned m = 0; m < Mixes.size(); ++m)
+    {
+      start = std::chrono::steady_clock::now();
+      for (const BenchOp& op : Mixes[m])
+      {
+        const BaselineKey& key = Keys[op.Key_];
+        if (op.Type_ == BenchOp::FIND)
+        {
+          auto it = table.find(key);
+          sum += it == table.end() ? 0 : it->second;
+        }
+        else if (op.Type_ == BenchOp::INSERT)
+        {
+          table.emplace(key, op.Key_);
+        }
+        else
+        {
+          table.erase(key);
+        }
+      }
+      ns = ElapsedNs(start);
+
+      for (unsigned i = 0; i < Keys.size(); ++i)
+      {
+        if (i % 2 == 0)
+        {
+          table.emplace(Keys[i], i);
+        }
+        else
+        {
+          table.erase(Keys[i]);
+        }
+      }
+
+      BenchRow& row = Rows[m + 1];
+      row.NsPerOp_ = std::min(row.NsPerOp_, ns / Mixes[m].size());
+    }
+
+    for (BenchRow& row : Rows)
+    {
+      row.PeakBytes_ = baseline_peak;
+    }
+
+    if (sum == 1)
+    {
+      std::printf("#\n");
+    }
+  }
+}
+
+/******************************************************************************
+ * @brief Makes a row with the columns that identify it filled in and the 
+ *  measurements waiting to be taken
+ * 
+ * @param Table 
+ * @param KeySet 
+ * @param Phase 
+ * @param Load 
+ * @param Growth 
+ * @param Policy 
+ * @param Secondary 
+ * @return BenchRow 
+ *****************************************************************************/
+static BenchRow MakeRow(const char *Table, const char *KeySet,
+  const char *Phase, double Load, const char *Growth, const char *Policy,
+  const char *Secondary)
+{
+  char config[128];
+  std::snprintf(config, sizeof(config), "%s,%s,%s,%.2f,%s,%s,%s", Table,
+    KeySet, Phase, Load, Growth, Policy, Secondary);
+  return {config, 1e300, 0.0, 0};
+}
+
+/******************************************************************************
+ * @brief Makes one row per phase of the sweep for a configuration
+ * 
+ * @param Table 
+ * @param KeySet 
+ * @param Load 
+ * @param Growth 
+ * @param Policy 
+ * @param Secondary 
+ * @return std::vector<BenchRow> 
+ *****************************************************************************/
+static std::vector<BenchRow> MakeRows(const char *Table, const char *KeySet,
+  double Load, const char *Growth, const char *Policy, const char *Secondary)
+{
+  std::vector<BenchRow> rows;
+  std::vector<std::string> phases(1, "build");
+  for (unsigned read : READ_MIXES)
+  {
+    phases.push_back("read" + std::to_string(read));
+  }
+
+  for (const std::string& phase : phases)
+  {
+    rows.push_back(MakeRow(Table, KeySet, phase.c_str(), Load, Growth, Policy,
+      Secondary));
+  }
+  return rows;
+}
+
+/******************************************************************************
+ * @brief Makes the rows RunLookups fills in: build, find_hit and find_miss
+ * 
+ * @param Table 
+ * @param KeySet 
+ * @param Load 
+ * @param Secondary 
+ * @return std::vector<BenchRow> 
+ *****************************************************************************/
+static std::vector<BenchRow> MakeLookupRows(const char *Table, 
+  const char *KeySet, double Load, const char *Secondary)
+{
+  std::vector<BenchRow> rows;
+  for (const char *phase : {"build", "find_hit", "find_miss"})
+  {
+    rows.push_back(MakeRow(Table, KeySet, phase, Load, "2.00", "MARK",
+      Secondary));
+  }
+  return rows;
+}
+
+/******************************************************************************
+ * @brief Times one table type and configuration for the feature 
+ *  comparisons: inserts the even keys into an empty table, then finds 
+ *  every even key (hits) and every odd key (misses). Fills in the rows from 
+ *  MakeLookupRows.
+ * 
+ * @tparam Table 
+ * @param Config 
+ * @param Keys 
+ * @param Rows 
+ *****************************************************************************/
+template<class Table> static void RunLookups(
+  const typename Table::OAHTConfig &Config,
+  const std::vector<std::string> &Keys, std::vector<BenchRow> &Rows)
+{
+  for (unsigned repeat = 0; repeat < REPEATS; ++repeat)
+  {
+    Table table(Config);
+    unsigned long long sum = 0;
+
+    unsigned probes = table.GetStats().Probes_;
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < Keys.size(); i += 2)
+    {
+      table.insert(Keys[i].c_str(), i);
+    }
+    Record(Rows[0], ElapsedNs(start), table.GetStats().Probes_ - probes,
+      (Keys.size() + 1) / 2);
+
+    for (unsigned miss = 0; miss < 2; ++miss)
+    {
+      probes = table.GetStats().Probes_;
+      start = std::chrono::steady_clock::now();
+      for (size_t i = miss; i < Keys.size(); i += 2)
+      {
+        const unsigned *data = table.try_find(Keys[i].c_str());
+        sum += data ? *data : 1;
+      }
+      Record(Rows[1 + miss], ElapsedNs(start), 
+        table.GetStats().Probes_ - probes, (Keys.size() + 1 - miss) / 2);
+    }
+
+    for (BenchRow& row : Rows)
+    {
+      row.PeakBytes_ = static_cast<long long>(table.GetStats().PeakBytes_);
+    }
+
+    if (sum == 1)
+    {
+      std::printf("#\n");
+    }
+  }
+}
+
+/******************************************************************************
+ * @brief Compares plain slots, where every probe reads a whole slot, with 
+ *  ControlBytes_, where a group of 16 slots is checked with one compare of 
+ *  their control bytes. Keys are short, so they fit in a plain slot.
+ * 
+ * @param Keys 
+ * @return std::vector<BenchRow> 
+ *****************************************************************************/
+static std::vector<BenchRow> RunLayouts(const std::vector<std::string> &Keys)
+{
+  std::vector<BenchRow> all;
+  for (double load : LOAD_FACTORS)
+  {
+    for (bool secondary : {false, true})
+    {
+      for (bool control_bytes : {false, true})
+      {
+        OAHashTable<unsigned>::OAHTConfig config(17, FNVHash,
+          secondary ? DJBHash : 0, load, 2.0);
+        config.ControlBytes_ = control_bytes;
+
+        std::vector<BenchRow> rows = MakeLookupRows(
+          control_bytes ? "oaht-ctrl" : "oaht-plain", "uniform", load,
+          secondary ? "djb2" : "none");
+        RunLookups<OAHashTable<unsigned>>(config, Keys, rows);
+        all.insert(all.end(), rows.begin(), rows.end());
+      }
+    }
+  }
+  return all;
+}
+
+/******************************************************************************
+ * @brief Compares find_many and insert_many in batches of each of 
+ *  BATCH_SIZES with a loop of single find and insert calls, on a table 
+ *  larger than the last-level cache. Lookups pick keys at random, so no two 
+ *  in a batch share a cache line. The table is kept between the find runs 
+ *  and rebuilt for every insert run.
+ * 
+ * @param Keys // far more keys than the other comparisons 
+ * @param Ops // number of lookups 
+ * @return std::vector<BenchRow> 
+ *****************************************************************************/
+static std::vector<BenchRow> RunBatches(const std::vector<std::string> &Keys,
+  unsigned Ops)
+{
+  std::vector<const char *> names(Keys.size());
+  std::vector<unsigned> data(Keys.size());
+  for (unsigned i = 0; i < Keys.size(); ++i)
+  {
+    names[i] = Keys[i].c_str();
+    data[i] = i;
+  }
+
+  std::mt19937 rng(1);
+  std::vector<const char *> lookups(Ops);
+  for (const char *&key : lookups)
+  {
+    key = names[rng() % names.size()];
+  }
+
+  OAHashTable<unsigned>::OAHTConfig config(17, FNVHash, 0, 0.7, 2.0);
+  std::vector<BenchRow> rows;
+  std::vector<std::string> tables(1, "oaht-loop");
+  for (unsigned batch : BATCH_SIZES)
+  {
+    tables.push_back("oaht-batch" + std::to_string(batch));
+  }
+  for (const std::string& table : tables)
+  {
+    rows.push_back(MakeRow(table.c_str(), "uniform", "insert", 0.7, "2.00",
+      "MARK", "none"));
+    rows.push_back(MakeRow(table.c_str(), "uniform", "find", 0.7, "2.00",
+      "MARK", "none"));
+  }
+
+  std::vector<const unsigned *> results(BATCH_SIZES[
+    sizeof(BATCH_SIZES) / sizeof(BATCH_SIZES[0]) - 1]);
+  unsigned long long sum = 0;
+
+  for (unsigned repeat = 0; repeat < REPEATS; ++repeat)
+  {
+    for (unsigned t = 0; t < tables.size(); ++t)
+    {
+      OAHashTable<unsigned> table(config);
+      unsigned batch = t ? BATCH_SIZES[t - 1] : 0;
+
+      unsigned probes = table.GetStats().Probes_;
+      auto start = std::chrono::steady_clock::now();
+      for (unsigned i = 0; i < names.size(); i += batch ? batch : 1)
+      {
+        if (!batch)
+        {
+          table.insert(names[i], data[i]);
+          continue;
+        }
+        unsigned count = static_cast<unsigned>(names.size()) - i;
+        table.insert_many(&names[i], &data[i], std::min(batch, count));
+      }
+      BenchRow& insert_row = rows[2 * t];
+      Record(insert_row, ElapsedNs(start), table.GetStats().Probes_ - probes,
+        names.size());
+      insert_row.PeakBytes_ = 
+        static_cast<long long>(table.GetStats().PeakBytes_);
+
+      probes = table.GetStats().Probes_;
+      start = std::chrono::steady_clock::now();
+      for (unsigned i = 0; i < Ops; i += batch ? batch : 1)
+      {
+        if (!batch)
+        {
+          const unsigned *found = table.try_find(lookups[i]);
+          sum += found ? *found : 1;
+          continue;
+        }
+        unsigned count = std::min(batch, Ops - i);
+        table.find_many(&lookups[i], count, results.data());
+        for (unsigned j = 0; j < count; ++j)
+        {
+          sum += results[j] ? *results[j] : 1;
+        }
+      }
+      BenchRow& find_row = rows[2 * t + 1];
+      Record(find_row, ElapsedNs(start), table.GetStats().Probes_ - probes,
+        Ops);
+      find_row.PeakBytes_ = insert_row.PeakBytes_;
+    }
+  }
+
+  if (sum == 1)
+  {
+    std::printf("#\n");
+  }
+  return rows;
+}
+
+/******************************************************************************
+ * @brief Compares prime table sizes, where every probe takes a modulo, with 
+ *  power-of-two sizes, where it takes a mask, with and without double 
+ *  hashing. Power-of-two tables mix the hash, so they cost a little more 
+ *  per hash and their probe counts differ.
+ * 
+ * @param Keys 
+ * @return std::vector<BenchRow> 
+ *****************************************************************************/
+static std::vector<BenchRow> RunCapacities(
+  const std::vector<std::string> &Keys)
+{
+  std::vector<BenchRow> all;
+  for (double load : LOAD_FACTORS)
+  {
+    for (bool secondary : {false, true})
+    {
+      for (bool pow2 : {false, true})
+      {
+        OAHashTable<unsigned>::OAHTConfig config(17, FNVHash,
+          secondary ? DJBHash : 0, load, 2.0);
+        if (pow2)
+        {
+          config.CapacityPolicy_ = OAHTCapacityPolicy::POWER_OF_TWO;
+        }
+
+        std::vector<BenchRow> rows = MakeLookupRows(
+          pow2 ? "oaht-pow2" : "oaht-prime", "uniform", load,
+          secondary ? "djb2" : "none");
+        RunLookups<OAHashTable<unsigned>>(config, Keys, rows);
+        all.insert(all.end(), rows.begin(), rows.end());
+      }
+    }
+  }
+  return all;
+}
+
+/******************************************************************************
+ * @brief Compares the throwing API with try_find, try_insert and emplace. 
+ *  Lookups and inserts are miss-heavy: MISS_PERCENT of the lookups miss 
+ *  and the same share of inserts are duplicates, which cost an exception 
+ *  each through find and insert. Builds of std::string data compare insert, 
+ *  which copies each value in, with emplace, which builds it in the slot.
+ * 
+ * @param Keys 
+ * @param Ops 
+ * @return std::vector<BenchRow> 
+ *****************************************************************************/
+static std::vector<BenchRow> RunTryApi(const std::vector<std::string> &Keys,
+  unsigned Ops)
+{
+  // Odd keys are never inserted, so they miss. For the inserts they are 
+  // the new keys and the even ones the duplicates.
+  std::mt19937 rng(2);
+  std::vector<unsigned> picks(Ops);
+  unsigned half = static_cast<unsigned>(Keys.size() / 2);
+  for (unsigned& pick : picks)
+  {
+    pick = 2 * (rng() % half) + (rng() % 100 < MISS_PERCENT);
+  }
+
+  const char *apis[] = {"oaht-find", "oaht-try_find", "oaht-insert",
+    "oaht-try_insert", "oaht-insert", "oaht-emplace"};
+  const char *phases[] = {"miss90", "miss90", "dup90", "dup90",
+    "build_string", "build_string"};
+  std::vector<BenchRow> rows;
+  for (unsigned i = 0; i < 6; ++i)
+  {
+    rows.push_back(MakeRow(apis[i], "uniform", phases[i], 0.7, "2.00", "MARK",
+      "none"));
+  }
+
+  OAHashTable<unsigned>::OAHTConfig config(17, FNVHash, 0, 0.7, 2.0);
+  OAHashTable<std::string>::OAHTConfig string_config(17, FNVHash, 0, 0.7,
+    2.0);
+  unsigned long long sum = 0;
+
+  for (unsigned repeat = 0; repeat < REPEATS; ++repeat)
+  {
+    for (unsigned api = 0; api < 4; ++api)
+    {
+      OAHashTable<unsigned> table(config);
+      for (unsigned i = 0; i < Keys.size(); i += 2)
+      {
+        table.insert(Keys[i].c_str(), i);
+      }
+
+      // Duplicate inserts go in with the odd keys flipped to even
+      unsigned flip = api < 2 ? 0 : 1;
+      unsigned probes = table.GetStats().Probes_;
+      auto start = std::chrono::steady_clock::now();
+      for (unsigned pick : picks)
+      {
+        const char *key = Keys[pick ^ flip].c_str();
+        if (api == 0)
+        {
+          try
+          {
+            sum += table.find(key);
+          }
+          catch(const OAHashTableException &)
+          {
+            ++sum;
+          }
+        }
+        else if (api == 1)
+        {
+          const unsigned *data = table.try_find(key);
+          sum += data ? *data : 1;
+        }
+        else if (api == 2)
+        {
+          try
+          {
+            table.insert(key, pick);
+          }
+          catch(const OAHashTableException &)
+          {
+            ++sum;
+          }
+        }
+        else
+        {
+          sum += table.try_insert(key, pick);
+        }
+      }
+      Record(rows[api], ElapsedNs(start), table.GetStats().Probes_ - probes,
+        picks.size());
+      rows[api].PeakBytes_ = 
+        static_cast<long long>(table.GetStats().PeakBytes_);
+    }
+
+    for (unsigned api = 4; api < 6; ++api)
+    {
+      OAHashTable<std::string> table(string_config);
+      unsigned probes = table.GetStats().Probes_;
+      auto start = std::chrono::steady_clock::now();
+      for (const std::string& key : Keys)
+      {
+        if (api == 4)
+        {
+          table.insert(key.c_str(), std::string(STRING_DATA_LENGTH, 'x'));
+        }
+        else
+        {
+          table.emplace(key.c_str(), STRING_DATA_LENGTH, 'x');
+        }
+      }
+      Record(rows[api], ElapsedNs(start), table.GetStats().Probes_ - probes,
+        Keys.size());
+      rows[api].PeakBytes_ = 
+        static_cast<long long>(table.GetStats().PeakBytes_);
+    }
+  }
+
+  if (sum == 1)
+  {
+    std::printf("#\n");
+  }
+  return rows;
+}
+
+/******************************************************************************
+ * @brief Compares the built-in hash policies, which inline into the probe, 
+ *  with FNV-1a through the config's function pointer. OAHTIntegerHash only 
+ *  runs on decimal IDs, since anything else falls back to OAHTStringHash. 
+ *  Keys are kept in the arena so long ones hash in full.
+ * 
+ * @param Count // number of keys per key set 
+ * @return std::vector<BenchRow> 
+ *****************************************************************************/
+static std::vector<BenchRow> RunHashPolicies(unsigned Count)
+{
+  typedef OAHashTable<unsigned> FunctionTable;
+  typedef OAHashTable<unsigned, OAHTStringHash> StringTable;
+  typedef OAHashTable<unsigned, OAHTIntegerHash> IntegerTable;
+
+  std::vector<BenchRow> all;
+  for (bool ids : {true, false})
+  {
+    std::vector<std::string> keys = ids ? MakeIds(Count) 
+                                        : MakeKeys(Count, true);
+    const char *key_set = ids ? "ids" : "prefix";
+
+    FunctionTable::OAHTConfig function_config(17, FNVHash, 0, 0.7, 2.0);
+    function_config.ArenaKeys_ = true;
+    std::vector<BenchRow> rows = MakeLookupRows("oaht-fnv", key_set, 0.7,
+      "none");
+    RunLookups<FunctionTable>(function_config, keys, rows);
+    all.insert(all.end(), rows.begin(), rows.end());
+
+    StringTable::OAHTConfig string_config(17, 0, 0, 0.7, 2.0);
+    string_config.ArenaKeys_ = true;
+    rows = MakeLookupRows("oaht-string", key_set, 0.7, "none");
+    RunLookups<StringTable>(string_config, keys, rows);
+    all.insert(all.end(), rows.begin(), rows.end());
+
+    if (ids)
+    {
+      IntegerTable::OAHTConfig integer_config(17, 0, 0, 0.7, 2.0);
+      integer_config.ArenaKeys_ = true;
+      rows = MakeLookupRows("oaht-integer", key_set, 0.7, "none");
+      RunLookups<IntegerTable>(integer_config, keys, rows);
+      all.insert(all.end(), rows.begin(), rows.end());
+    }
+  }
+  return all;
+}
+
+/******************************************************************************
+ * @brief Reads the rows of an earlier run's CSV, keyed by their
+ *  configuration columns
+ * 
+ * @param Path 
+ * @return std::map<std::string, BenchRow> 
+ *****************************************************************************/
+static std::map<std::string, BenchRow> ReadBaseline(const char *Path)
+{
+  std::map<std::string, BenchRow> rows;
+  std::ifstream file(Path);
+  std::string line;
+  while (std::getline(file, line))
+  {
+    // The last three columns are the measurements
+    size_t peak = line.rfind(',');
+    size_t probes = peak == std::string::npos ? peak
+                                              : line.rfind(',', peak - 1);
+    size_t ns = probes == std::string::npos ? probes
+                                            : line.rfind(',', probes - 1);
+    if (ns == std::string::npos || line.compare(0, 5, "table") == 0)
+    {
+      continue;
+    }
+
+    BenchRow row;
+    row.Config_ = line.substr(0, ns);
+    row.NsPerOp_ = std::atof(line.c_str() + ns + 1);
+    row.ProbesPerOp_ = std::atof(line.c_str() + probes + 1);
+    row.PeakBytes_ = std::atoll(line.c_str() + peak + 1);
+    rows[row.Config_] = row;
+  }
+  return rows;
+}
+
+/******************************************************************************
+ * @brief Prints rows as CSV and, if there is a baseline, reports each
+ *  OAHashTable row whose probes/op or peak bytes went up, or whose ns/op
+ *  went up by more than Slowdown percent. A negative Slowdown leaves ns/op
+ *  out of the gate.
+ * 
+ * @param Rows 
+ * @param Baseline 
+ * @param Slowdown 
+ * @return unsigned // number of regressions 
+ *****************************************************************************/
+static unsigned Report(const std::vector<BenchRow> &Rows,
+  const std::map<std::string, BenchRow> &Baseline, double Slowdown)
+{
+  unsigned regressions = 0;
+  double limit = 1.0 + COUNT_TOLERANCE;
+
+  for (const BenchRow& row : Rows)
+  {
+    std::printf("%s,%.2f,%.3f,%lld\n", row.Config_.c_str(), row.NsPerOp_,
+      row.ProbesPerOp_, row.PeakBytes_);
+
+    auto it = Baseline.find(row.Config_);
+    if (it == Baseline.end() || row.Config_.compare(0, 4, "oaht") != 0)
+    {
+      continue;
+    }
+    const BenchRow& was = it->second;
+    if (row.ProbesPerOp_ > was.ProbesPerOp_ * limit + 0.001 ||
+      row.PeakBytes_ > was.PeakBytes_ * limit ||
+      (Slowdown >= 0.0 && row.NsPerOp_ > was.NsPerOp_ * 
+        (1.0 + Slowdown / 100.0)))
+    {
+      std::fprintf(stderr, "regression %s: %.2f ns/op (was %.2f), "
+        "%.3f probes/op (was %.3f), %lld bytes (was %lld)\n",
+        row.Config_.c_str(), row.NsPerOp_, was.NsPerOp_, row.ProbesPerOp_,
+        was.ProbesPerOp_, row.PeakBytes_, was.PeakBytes_);
+      ++regressions;
+    }
+  }
+  return regressions;
+}
+
+/******************************************************************************
+ * @brief Runs the sweep and the feature comparisons and prints the results. 
+ *  Sweep keys are kept whole in the arena so long keys hash and compare in 
+ *  full. PACK only packs along the removed key's probe step, which strands 
+ *  entries that reached the slot on a different step, so it is only run 
+ *  without a secondary hash.
+ * 
+ * @param argc 
+ * @param argv 
+ * @return int // non-zero if the gate found a regression 
+ *****************************************************************************/
+int main(int argc, char *argv[])
+{
+  unsigned key_count = argc > 1 ? std::atoi(argv[1]) : 1u << 18;
+  unsigned op_count = argc > 2 ? std::atoi(argv[2]) : 1u << 20;
+  std::map<std::string, BenchRow> baseline;
+  if (argc > 3)
+  {
+    baseline = ReadBaseline(argv[3]);
+  }
+  double slowdown = argc > 4 ? std::atof(argv[4]) : -1.0;
+
+  struct KeySet
+  {
+    const char *Name_;
+    bool SharedPrefix_;
+    bool Zipf_;
+  };
+  const KeySet key_sets[] = {{"uniform", false, false},
+    {"zipf", false, true}, {"prefix", true, false}};
+
+  std::printf("table,keys,phase,load,growth,policy,secondary,"
+    "ns_op,probes_op,peak_bytes\n");
+  unsigned regressions = 0;
+
+  for (const KeySet& key_set : key_sets)
+  {
+    std::vector<std::string> keys = MakeKeys(key_count, key_set.SharedPrefix_);
+    KeyPicker picker(key_count, key_set.Zipf_);
+    std::vector<std::vector<BenchOp>> mixes;
+    for (unsigned read : READ_MIXES)
+    {
+      mixes.push_back(MakeOps(op_count, read, picker, key_count));
+    }
+
+    for (double load : LOAD_FACTORS)
+    {
+      for (double growth : GROWTH_FACTORS)
+      {
+        for (unsigned policy = OAHTDeletionPolicy::MARK;
+          policy <= OAHTDeletionPolicy::PACK; ++policy)
+        {
+          for (bool secondary : {false, true})
+          {
+            if (policy == OAHTDeletionPolicy::PACK && secondary)
+            {
+              continue;
+            }
+
+            OAHashTable<unsigned>::OAHTConfig config(17, FNVHash,
+              secondary ? DJBHash : 0, load, growth,
+              static_cast<OAHTDeletionPolicy>(policy));
+            config.ArenaKeys_ = true;
+
+            char growth_name[16];
+            std::snprintf(growth_name, sizeof(growth_name), "%.2f", growth);
+            std::vector<BenchRow> rows = MakeRows("oaht", key_set.Name_,
+              load, growth_name,
+              policy == OAHTDeletionPolicy::MARK ? "MARK" : "PACK",
+              secondary ? "djb2" : "none");
+            RunTable(config, keys, mixes, rows);
+            regressions += Report(rows, baseline, slowdown);
+          }
+        }
+      }
+
+      // The baseline only shares the load factor with the table
+      std::vector<BaselineKey> baseline_keys;
+      for (const std::string& key : keys)
+      {
+        baseline_keys.emplace_back(key.data(), key.size());
+      }
+      std::vector<BenchRow> rows = MakeRows("unordered_map", key_set.Name_,
+        load, "-", "-", "-");
+      RunBaseline(load, baseline_keys, mixes, rows);
+      regressions += Report(rows, baseline, slowdown);
+    }
+  }
+
+  std::vector<std::string> keys = MakeKeys(key_count, false);
+  regressions += Report(RunLayouts(keys), baseline, slowdown);
+  regressions += Report(RunBatches(MakeKeys(key_count * BATCH_KEY_SCALE,
+    false), op_count), baseline, slowdown);
+  regressions += Report(RunCapacities(keys), baseline, slowdown);
+  regressions += Report(RunTryApi(keys, op_count), baseline, slowdown);
+  regressions += Report(RunHashPolicies(key_count), baseline, slowdown);
+
+  if (regressions)
+  {
+    std::fprintf(stderr, "%u regressions\n", regressions);
+  }
+  return regressions ? 1 : 0;
+}
@@ -0,0 +1,194 @@
+/******************************************************************************
+ * @file OAHashTable_bulk_insert_test.cpp
+ * @author Jay Sharma
+ * @brief Differential test for OAHashTable::bulk_insert and the range
+ *  constructor. Builds tables from inputs full of repeated keys with one to
+ *  eight threads, in every deletion policy and layout, both empty and
+ *  already holding some of the keys, and checks them against a std::map
+ *  filled one pair at a time in input order: the first occurrence of a key
+ *  must win, keys already in the table must keep their data, and the
+ *  returned duplicate count and Count_ must match. Prints one line per
+ *  failed check and returns non-zero if there were any.
+ * 
+ *  Usage: OAHashTable_bulk_insert_test
+ * @version 0.1
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ *****************************************************************************/
+
+#include "OAHashTable.h"
+
+#include <cstdio>
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Pairs in each input, drawn from a smaller key space so that most keys
+// repeat. Every key fits in MAX_KEYLEN - 1 bytes, so plain slots keep it
+// whole.
+static const unsigned PAIR_COUNT = 60000;
+static const unsigned KEY_SPACE = 20000;
+
+// Keys put in the table before the bulk insert, for the non-empty cases
+static const unsigned PREFILL_COUNT = 3000;
+
+// Thread counts under test; enough pairs per thread that all of them run
+static const unsigned THREADS[] = {1, 2, 3, 4, 8};
+
+// Number of failed checks so far
+static unsigned failures = 0;
+
+typedef std::vector<std::pair<std::string, unsigned> > Pairs;
+
+/******************************************************************************
+ * @brief Records a failed check
+ * 
+ * @param Ok 
+ * @param What 
+ * @param Config // name of the table configuration being tested 
+ *****************************************************************************/
+static void Check(bool Ok, const char *What, const std::string &Config)
+{
+  if (!Ok)
+  {
+    std::printf("FAIL %s: %s\n", Config.c_str(), What);
+    ++failures;
+  }
+}
+
+/******************************************************************************
+ * @brief FNV-1a, the primary hash function of the tables under test
+ * 
+ * @param Key 
+ * @param TableSize 
+ * @return unsigned 
+ *****************************************************************************/
+static unsigned FNVHash(const char *Key, unsigned TableSize)
+{
+  unsigned hash = 2166136261u;
+  for (; *Key; ++Key)
+  {
+    hash = (hash ^ static_cast<unsigned char>(*Key)) * 16777619u;
+  }
+  return hash % TableSize;
+}
+
+/******************************************************************************
+ * @brief Checks the table against the reference map: every key in Expected
+ *  is found with its data, and Count_ matches
+ * 
+ * @param Table 
+ * @param Expected 
+ * @param Name 
+ *****************************************************************************/
+static void Compare(const OAHashTable<unsigned> &Table,
+  const std::map<std::string, unsigned> &Expected, const std::string &Name)
+{
+  bool found = true;
+  for (const auto &pair : Expected)
+  {
+    const unsigned *data = Table.try_find(pair.first.c_str());
+    found = found && data && *data == pair.second;
+  }
+  Check(found, "first occurrence of each key", Name);
+  Check(Table.GetStats().Count_ == Expected.size(), "Count_", Name);
+}
+
+/******************************************************************************
+ * @brief Bulk inserts Input into an empty table and into one prefilled with
+ *  the first PREFILL_COUNT keys of the key space, with every thread count,
+ *  and builds one with the range constructor
+ * 
+ * @param Config 
+ * @param Input 
+ * @param Name 
+ *****************************************************************************/
+static void Build(const OAHashTable<unsigned>::OAHTConfig &Config,
+  const Pairs &Input, const std::string &Name)
+{
+  // The reference keeps the first occurrence, as emplace does
+  std::map<std::string, unsigned> expected;
+  unsigned duplicates = 0;
+  for (const auto &pair : Input)
+  {
+    duplicates += expected.emplace(pair.first, pair.second).second ? 0 : 1;
+  }
+
+  std::map<std::string, unsigned> prefilled;
+  for (unsigned i = 0; i < PREFILL_COUNT; ++i)
+  {
+    prefilled.emplace("b" + std::to_string(i), i + 1000000);
+  }
+  unsigned prefilled_duplicates = 0;
+  for (const auto &pair : Input)
+  {
+    prefilled_duplicates +=
+      prefilled.emplace(pair.first, pair.second).second ? 0 : 1;
+  }
+
+  for (unsigned threads : THREADS)
+  {
+    std::string name = Name + ", " + std::to_string(threads) + " threads";
+
+    OAHashTable<unsigned> table(Config);
+    unsigned skipped = table.bulk_insert(Input.begin(), Input.end(), threads);
+    Check(skipped == duplicates, "duplicate count", name);
+    Compare(table, expected, name);
+
+    OAHashTable<unsigned> filled(Config);
+    for (unsigned i = 0; i < PREFILL_COUNT; ++i)
+    {
+      filled.insert(("b" + std::to_string(i)).c_str(), i + 1000000);
+    }
+    skipped = filled.bulk_insert(Input.begin(), Input.end(), threads);
+    Check(skipped == prefilled_duplicates, "duplicate count when prefilled",
+      name + " prefilled");
+    Compare(filled, prefilled, name + " prefilled");
+
+    OAHashTable<unsigned> constructed(Config, Input.begin(), Input.end(),
+      threads);
+    Compare(constructed, expected, name + " constructed");
+  }
+}
+
+/******************************************************************************
+ * @brief Makes the input and builds it with each deletion policy in the
+ *  plain, control byte and power-of-two layouts
+ * 
+ * @return int 
+ *****************************************************************************/
+int main()
+{
+  // Each key's data is its position, so the winner can be told apart
+  std::mt19937 random(2021);
+  Pairs input;
+  for (unsigned i = 0; i < PAIR_COUNT; ++i)
+  {
+    input.emplace_back("b" + std::to_string(random() % KEY_SPACE), i);
+  }
+
+  const char *policies[] = {"MARK", "PACK", "ROBINHOOD"};
+  for (unsigned policy = OAHTDeletionPolicy::MARK;
+    policy <= OAHTDeletionPolicy::ROBINHOOD; ++policy)
+  {
+    OAHashTable<unsigned>::OAHTConfig config(7, FNVHash, 0, 0.7, 2.0,
+      static_cast<OAHTDeletionPolicy>(policy));
+    std::string name = policies[policy];
+    Build(config, input, name + " plain");
+
+    config.ControlBytes_ = true;
+    config.StoreHash_ = true;
+    Build(config, input, name + " ctrl");
+
+    config.CapacityPolicy_ = OAHTCapacityPolicy::POWER_OF_TWO;
+    Build(config, input, name + " pow2");
+  }
+
+  std::printf("%s (%u failed checks)\n", failures ? "FAILED" : "PASSED",
+    failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,220 @@
+/******************************************************************************
+ * @file OAHashTable_resize_test.cpp
+ * @author Jay Sharma
+ * @brief Differential test for OAHashTable incremental resizing. Drives
+ *  tables with IncrementalResize_ on through many growth steps with insert,
+ *  insert_many and remove, mirrors every operation in a std::map, and after
+ *  each batch checks that every key in the map is found with its data, that
+ *  removed keys are gone and that the counts agree. Batches are large
+ *  enough that a new table is swapped in partway through an insert_many.
+ *  Prints one line per failed check and returns non-zero if there were any.
+ * 
+ *  Usage: OAHashTable_resize_test
+ * @version 0.1
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ *****************************************************************************/
+
+#include "OAHashTable.h"
+
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+// Keys inserted into each table, from a 7 slot start. Every key fits in
+// MAX_KEYLEN - 1 bytes, so plain slots keep it whole.
+static const unsigned KEY_COUNT = 20000;
+
+// Number of failed checks so far
+static unsigned failures = 0;
+
+/******************************************************************************
+ * @brief Records a failed check
+ * 
+ * @param Ok 
+ * @param What 
+ * @param Config // name of the table configuration being tested 
+ *****************************************************************************/
+static void Check(bool Ok, const char *What, const char *Config)
+{
+  if (!Ok)
+  {
+    std::printf("FAIL %s: %s\n", Config, What);
+    ++failures;
+  }
+}
+
+/******************************************************************************
+ * @brief FNV-1a, the primary hash function of the tables under test
+ * 
+ * @param Key 
+ * @param TableSize 
+ * @return unsigned 
+ *****************************************************************************/
+static unsigned FNVHash(const char *Key, unsigned TableSize)
+{
+  unsigned hash = 2166136261u;
+  for (; *Key; ++Key)
+  {
+    hash = (hash ^ static_cast<unsigned char>(*Key)) * 16777619u;
+  }
+  return hash % TableSize;
+}
+
+/******************************************************************************
+ * @brief Checks the table against the reference map: every key in Expected
+ *  is found with its data through try_find and find_many, every key in
+ *  Removed is missing, and Count_ matches
+ * 
+ * @param Table 
+ * @param Expected 
+ * @param Removed 
+ * @param Name 
+ *****************************************************************************/
+static void Compare(const OAHashTable<unsigned> &Table,
+  const std::map<std::string, unsigned> &Expected,
+  const std::vector<std::string> &Removed, const char *Name)
+{
+  std::vector<const char *> keys;
+  for (const auto &pair : Expected)
+  {
+    const unsigned *data = Table.try_find(pair.first.c_str());
+    Check(data && *data == pair.second, "try_find of an inserted key", Name);
+    keys.push_back(pair.first.c_str());
+  }
+
+  std::vector<const unsigned *> results(keys.size());
+  Table.find_many(keys.data(), static_cast<unsigned>(keys.size()),
+    results.data());
+  unsigned i = 0;
+  for (const auto &pair : Expected)
+  {
+    Check(results[i] && *results[i] == pair.second,
+      "find_many of an inserted key", Name);
+    ++i;
+  }
+
+  for (const std::string &key : Removed)
+  {
+    if (Expected.count(key) == 0)
+    {
+      Check(Table.try_find(key.c_str()) == 0, "find of a removed key", Name);
+    }
+  }
+
+  Check(Table.GetStats().Count_ == Expected.size(), "Count_", Name);
+}
+
+/******************************************************************************
+ * @brief Grows one table from 7 slots to KEY_COUNT keys. Keys go in through
+ *  insert_many batches of rising size with single inserts between them,
+ *  and every fifth key of each batch is removed again. The whole table is
+ *  compared with the reference after each round.
+ * 
+ * @param Config 
+ * @param Name 
+ *****************************************************************************/
+static void Grow(const OAHashTable<unsigned>::OAHTConfig &Config,
+  const char *Name)
+{
+  OAHashTable<unsigned> table(Config);
+  std::map<std::string, unsigned> expected;
+  std::vector<std::string> removed;
+
+  unsigned next = 0;
+  unsigned batch = 1;
+  unsigned expansions = 0;
+  while (next < KEY_COUNT)
+  {
+    std::vector<std::string> names;
+    std::vector<unsigned> data;
+    for (unsigned i = 0; i < batch && next < KEY_COUNT; ++i, ++next)
+    {
+      names.push_back("k" + std::to_string(next));
+      data.push_back(next * 7);
+    }
+
+    std::vector<const char *> keys;
+    for (const std::string &key : names)
+    {
+      keys.push_back(key.c_str());
+    }
+    table.insert_many(keys.data(), data.data(),
+      static_cast<unsigned>(keys.size()));
+    for (unsigned i = 0; i < names.size(); ++i)
+    {
+      expected[names[i]] = data[i];
+    }
+
+    if (next < KEY_COUNT)
+    {
+      std::string key = "s" + std::to_string(next);
+      table.insert(key.c_str(), next);
+      expected[key] = next;
+    }
+
+    for (unsigned i = 0; i < names.size(); i += 5)
+    {
+      table.remove(names[i].c_str());
+      expected.erase(names[i]);
+      removed.push_back(names[i]);
+    }
+
+    Compare(table, expected, removed, Name);
+    expansions = table.GetStats().Expansions_;
+    batch = batch < 512 ? batch * 2 : batch + 37;
+  }
+
+  Check(expansions > 8, "table grew", Name);
+
+  // Duplicates are still caught in the middle of a resize
+  bool rejected = false;
+  try
+  {
+    const char *keys[] = {"fresh", "k2"};
+    unsigned data[] = {1, 2};
+    table.insert_many(keys, data, 2);
+  }
+  catch(const OAHashTableException &e)
+  {
+    rejected = e.code() == OAHashTableException::E_DUPLICATE;
+  }
+  Check(rejected, "insert_many of a duplicate", Name);
+  expected["fresh"] = 1;
+  Compare(table, expected, removed, Name);
+}
+
+/******************************************************************************
+ * @brief Runs the growth test over each deletion policy with the plain,
+ *  control byte and power-of-two layouts, all with incremental resizing
+ * 
+ * @return int 
+ *****************************************************************************/
+int main()
+{
+  const char *policies[] = {"MARK", "PACK", "ROBINHOOD"};
+
+  for (unsigned policy = OAHTDeletionPolicy::MARK;
+    policy <= OAHTDeletionPolicy::ROBINHOOD; ++policy)
+  {
+    OAHashTable<unsigned>::OAHTConfig config(7, FNVHash, 0, 0.7, 2.0,
+      static_cast<OAHTDeletionPolicy>(policy));
+    config.IncrementalResize_ = true;
+    std::string name = policies[policy];
+    Grow(config, (name + " plain").c_str());
+
+    config.ControlBytes_ = true;
+    config.StoreHash_ = true;
+    Grow(config, (name + " ctrl").c_str());
+
+    config.CapacityPolicy_ = OAHTCapacityPolicy::POWER_OF_TWO;
+    Grow(config, (name + " pow2").c_str());
+  }
+
+  std::printf("%s (%u failed checks)\n", failures ? "FAILED" : "PASSED",
+    failures);
+  return failures ? 1 : 0;
+}
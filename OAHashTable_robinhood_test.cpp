@@ -0,0 +1,245 @@
+/******************************************************************************
+ * @file OAHashTable_robinhood_test.cpp
+ * @author Jay Sharma
+ * @brief Differential test for ROBINHOOD tables and backward-shift deletion.
+ *  Runs a random mix of inserts, removes and finds at a high load factor,
+ *  mirrors it in a std::map and checks every result against the map. After
+ *  each round the whole table is checked: every key in the map is found
+ *  with its data, removed keys are gone, counts agree, no slot is left
+ *  DELETED, and the distances kept in the slots still have the Robin Hood
+ *  order with no gaps in front of a displaced entry. Prints one line per
+ *  failed check and returns non-zero if there were any.
+ * 
+ *  Usage: OAHashTable_robinhood_test
+ * @version 0.1
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ *****************************************************************************/
+
+#include "OAHashTable.h"
+
+#include <cstdio>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+// Distinct keys the operations draw from. Every key fits in MAX_KEYLEN - 1
+// bytes, so plain slots keep it whole.
+static const unsigned KEY_SPACE = 3000;
+
+// Operations per table, and how often the whole table is checked
+static const unsigned OPERATION_COUNT = 60000;
+static const unsigned ROUND_LENGTH = 2000;
+
+// Number of failed checks so far
+static unsigned failures = 0;
+
+/******************************************************************************
+ * @brief Records a failed check
+ * 
+ * @param Ok 
+ * @param What 
+ * @param Config // name of the table configuration being tested 
+ *****************************************************************************/
+static void Check(bool Ok, const char *What, const char *Config)
+{
+  if (!Ok)
+  {
+    std::printf("FAIL %s: %s\n", Config, What);
+    ++failures;
+  }
+}
+
+/******************************************************************************
+ * @brief FNV-1a, the primary hash function of the tables under test
+ * 
+ * @param Key 
+ * @param TableSize 
+ * @return unsigned 
+ *****************************************************************************/
+static unsigned FNVHash(const char *Key, unsigned TableSize)
+{
+  unsigned hash = 2166136261u;
+  for (; *Key; ++Key)
+  {
+    hash = (hash ^ static_cast<unsigned char>(*Key)) * 16777619u;
+  }
+  return hash % TableSize;
+}
+
+/******************************************************************************
+ * @brief Checks the slots of a Robin Hood table: none is DELETED, and an
+ *  entry d slots from home follows an occupied slot whose entry is at least
+ *  d - 1 from its own home, so nothing is further from home than the slot
+ *  before it allows and no empty slot breaks a probe sequence. Also checks
+ *  that the scanned MaxProbeLength_ matches the longest distance.
+ * 
+ * @param Table 
+ * @param Name 
+ *****************************************************************************/
+static void CheckSlots(const OAHashTable<unsigned> &Table, const char *Name)
+{
+  typedef OAHashTable<unsigned>::OAHTSlot Slot;
+  OAHTStats stats = Table.GetStats(true);
+  const Slot *slots = Table.GetTable();
+  unsigned size = stats.TableSize_;
+
+  bool no_tombstones = stats.Tombstones_ == 0;
+  bool ordered = true;
+  unsigned longest = 0;
+  for (unsigned i = 0; i < size; ++i)
+  {
+    const Slot &slot = slots[i];
+    no_tombstones = no_tombstones && slot.State != Slot::DELETED;
+    if (slot.State != Slot::OCCUPIED)
+    {
+      continue;
+    }
+
+    unsigned length = static_cast<unsigned>(slot.probes) + 1;
+    longest = length > longest ? length : longest;
+    if (slot.probes > 0)
+    {
+      const Slot &previous = slots[(i + size - 1) % size];
+      ordered = ordered && previous.State == Slot::OCCUPIED &&
+        previous.probes >= slot.probes - 1;
+    }
+  }
+
+  Check(no_tombstones, "no DELETED slots", Name);
+  Check(ordered, "Robin Hood order of the slot distances", Name);
+  Check(stats.MaxProbeLength_ == longest, "MaxProbeLength_", Name);
+}
+
+/******************************************************************************
+ * @brief Checks the table against the reference map: every key in Expected
+ *  is found with its data, every other key in the key space is missing,
+ *  and Count_ matches
+ * 
+ * @param Table 
+ * @param Expected 
+ * @param Name 
+ *****************************************************************************/
+static void Compare(const OAHashTable<unsigned> &Table,
+  const std::map<std::string, unsigned> &Expected, const char *Name)
+{
+  for (unsigned i = 0; i < KEY_SPACE; ++i)
+  {
+    std::string key = "r" + std::to_string(i);
+    auto it = Expected.find(key);
+    const unsigned *data = Table.try_find(key.c_str());
+    if (it == Expected.end())
+    {
+      Check(data == 0, "find of a missing key", Name);
+    }
+    else
+    {
+      Check(data && *data == it->second, "find of an inserted key", Name);
+    }
+  }
+
+  Check(Table.GetStats().Count_ == Expected.size(), "Count_", Name);
+}
+
+/******************************************************************************
+ * @brief Runs the random operation mix on one table. Inserts and removes
+ *  are equally likely, so the table hovers around half the key space and
+ *  removes keep shifting clusters back.
+ * 
+ * @param Config 
+ * @param Name 
+ *****************************************************************************/
+static void Churn(const OAHashTable<unsigned>::OAHTConfig &Config,
+  const char *Name)
+{
+  OAHashTable<unsigned> table(Config);
+  std::map<std::string, unsigned> expected;
+  std::mt19937 random(2021);
+
+  for (unsigned op = 1; op <= OPERATION_COUNT; ++op)
+  {
+    std::string key = "r" + std::to_string(random() % KEY_SPACE);
+    bool present = expected.count(key) != 0;
+    switch (random() % 3)
+    {
+      case 0:
+      {
+        bool inserted = table.try_insert(key.c_str(), op);
+        Check(inserted != present, "try_insert", Name);
+        if (inserted)
+        {
+          expected[key] = op;
+        }
+        break;
+      }
+      case 1:
+      {
+        bool removed = true;
+        try
+        {
+          table.remove(key.c_str());
+        }
+        catch(const OAHashTableException &e)
+        {
+          removed = false;
+          Check(e.code() == OAHashTableException::E_ITEM_NOT_FOUND,
+            "remove of a missing key", Name);
+        }
+        Check(removed == present, "remove", Name);
+        expected.erase(key);
+        break;
+      }
+      default:
+      {
+        const unsigned *data = table.try_find(key.c_str());
+        Check(present ? data && *data == expected[key] : data == 0, "find",
+          Name);
+        break;
+      }
+    }
+
+    if (op % ROUND_LENGTH == 0)
+    {
+      Compare(table, expected, Name);
+      CheckSlots(table, Name);
+    }
+  }
+
+  // Empty it again: every remove shifts what follows
+  while (!expected.empty())
+  {
+    table.remove(expected.begin()->first.c_str());
+    expected.erase(expected.begin());
+  }
+  Compare(table, expected, Name);
+  CheckSlots(table, Name);
+}
+
+/******************************************************************************
+ * @brief Runs the operation mix on Robin Hood tables with the plain, control
+ *  byte and power-of-two layouts
+ * 
+ * @return int 
+ *****************************************************************************/
+int main()
+{
+  OAHashTable<unsigned>::OAHTConfig config(7, FNVHash, 0, 0.9, 2.0,
+    OAHTDeletionPolicy::ROBINHOOD);
+  Churn(config, "plain");
+
+  config.ControlBytes_ = true;
+  Churn(config, "ctrl");
+
+  config.StoreHash_ = true;
+  Churn(config, "ctrl hash");
+
+  config.CapacityPolicy_ = OAHTCapacityPolicy::POWER_OF_TWO;
+  Churn(config, "pow2");
+
+  std::printf("%s (%u failed checks)\n", failures ? "FAILED" : "PASSED",
+    failures);
+  return failures ? 1 : 0;
+}
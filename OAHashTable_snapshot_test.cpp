@@ -0,0 +1,278 @@
+/******************************************************************************
+ * @file OAHashTable_snapshot_test.cpp
+ * @author Jay Sharma
+ * @brief Round-trip test for OAHashTable snapshots. Fills tables in every
+ *  deletion policy and key layout, saves them, loads them into fresh tables
+ *  and checks that GetTable() and GetStats() come back unchanged, before and
+ *  after the loaded table is promoted. Also checks that Load rejects headers
+ *  with out-of-range policy values. Prints one line per failed check and
+ *  returns non-zero if there were any.
+ * 
+ *  Usage: OAHashTable_snapshot_test [snapshot path]
+ * @version 0.1
+ * @date 2026-10-16
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ *****************************************************************************/
+
+#include "OAHashTable.h"
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+// Keys inserted into each table; every third one is removed again
+static const unsigned KEY_COUNT = 5000;
+
+// Number of failed checks so far
+static unsigned failures = 0;
+
+/******************************************************************************
+ * @brief Records a failed check
+ * 
+ * @param Ok 
+ * @param What 
+ * @param Config // name of the table configuration being tested 
+ *****************************************************************************/
+static void Check(bool Ok, const char *What, const char *Config)
+{
+  if (!Ok)
+  {
+    std::printf("FAIL %s: %s\n", Config, What);
+    ++failures;
+  }
+}
+
+/******************************************************************************
+ * @brief FNV-1a, the primary hash function of the tables under test
+ * 
+ * @param Key 
+ * @param TableSize 
+ * @return unsigned 
+ *****************************************************************************/
+static unsigned FNVHash(const char *Key, unsigned TableSize)
+{
+  unsigned hash = 2166136261u;
+  for (; *Key; ++Key)
+  {
+    hash = (hash ^ static_cast<unsigned char>(*Key)) * 16777619u;
+  }
+  return hash % TableSize;
+}
+
+/******************************************************************************
+ * @brief Makes the i-th test key. Some are longer than MAX_KEYLEN - 1, which
+ *  only arena tables keep whole, so those are only used there.
+ * 
+ * @param i 
+ * @param Long 
+ * @return std::string 
+ *****************************************************************************/
+static std::string MakeKey(unsigned i, bool Long)
+{
+  std::string key = std::to_string(i);
+  if (Long && i % 4 == 0)
+  {
+    key += "/a-key-too-long-for-the-slot";
+  }
+  return key;
+}
+
+/******************************************************************************
+ * @brief Compares the stats that a snapshot carries. Memory use is left out,
+ *  since a mapped table does not count the file.
+ * 
+ * @param A 
+ * @param B 
+ * @return true 
+ * @return false 
+ *****************************************************************************/
+static bool SameStats(const OAHTStats &A, const OAHTStats &B)
+{
+  return A.Count_ == B.Count_ && A.TableSize_ == B.TableSize_ &&
+    A.Probes_ == B.Probes_ && A.Expansions_ == B.Expansions_ &&
+    A.Compactions_ == B.Compactions_ && A.Tombstones_ == B.Tombstones_ &&
+    memcmp(A.ProbeHistogram_, B.ProbeHistogram_,
+      sizeof(A.ProbeHistogram_)) == 0 &&
+    A.MeanProbeLength_ == B.MeanProbeLength_ &&
+    A.MaxProbeLength_ == B.MaxProbeLength_ &&
+    A.LongestCluster_ == B.LongestCluster_ &&
+    A.TombstoneRatio_ == B.TombstoneRatio_ &&
+    A.PrimaryHashFunc_ == B.PrimaryHashFunc_ &&
+    A.SecondaryHashFunc_ == B.SecondaryHashFunc_;
+}
+
+/******************************************************************************
+ * @brief Compares two slot arrays slot by slot. Only the fields that mean
+ *  something for the slot's state are compared.
+ * 
+ * @tparam Table 
+ * @param A 
+ * @param B 
+ * @param Size 
+ * @return true 
+ * @return false 
+ *****************************************************************************/
+template<class Table> static bool SameSlots(const Table &A, const Table &B,
+  unsigned Size)
+{
+  typedef typename Table::OAHTSlot Slot;
+  const Slot *a = A.GetTable();
+  const Slot *b = B.GetTable();
+  for (unsigned i = 0; i < Size; ++i)
+  {
+    if (a[i].State != b[i].State)
+    {
+      return false;
+    }
+    if (a[i].State == Slot::OCCUPIED && (a[i].Data != b[i].Data ||
+      a[i].Len != b[i].Len || a[i].Hash != b[i].Hash ||
+      a[i].probes != b[i].probes || a[i].KeyOffset != b[i].KeyOffset))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+/******************************************************************************
+ * @brief Fills a table, saves it to Path, loads it into a second table and
+ *  checks the round trip, then promotes the loaded table with an insert and
+ *  checks every key again
+ * 
+ * @tparam Table 
+ * @param Config 
+ * @param LongKeys // whether the table keeps keys whole 
+ * @param Name 
+ * @param Path 
+ *****************************************************************************/
+template<class Table> static void RoundTrip(
+  const typename Table::OAHTConfig &Config, bool LongKeys, const char *Name,
+  const char *Path)
+{
+  Table table(Config);
+  for (unsigned i = 0; i < KEY_COUNT; ++i)
+  {
+    table.insert(MakeKey(i, LongKeys).c_str(), i);
+  }
+  for (unsigned i = 0; i < KEY_COUNT; i += 3)
+  {
+    table.remove(MakeKey(i, LongKeys).c_str());
+  }
+
+  table.Save(Path);
+  Table loaded(Config);
+  loaded.Load(Path);
+
+  OAHTStats saved_stats = table.GetStats(true);
+  Check(SameStats(saved_stats, loaded.GetStats(true)), "stats after Load",
+    Name);
+  Check(SameSlots(table, loaded, saved_stats.TableSize_),
+    "slots after Load", Name);
+
+  // The first write copies the table out of the file
+  loaded.insert("promoted", KEY_COUNT);
+  for (unsigned i = 0; i < KEY_COUNT; ++i)
+  {
+    const unsigned *data = loaded.try_find(MakeKey(i, LongKeys).c_str());
+    Check(i % 3 ? data && *data == i : !data, "lookup after Promote", Name);
+  }
+  Check(loaded.GetStats().Count_ == saved_stats.Count_ + 1,
+    "count after Promote", Name);
+}
+
+/******************************************************************************
+ * @brief Saves a small table, overwrites one unsigned field of the snapshot
+ *  header with Value and checks that Load throws E_SNAPSHOT
+ * 
+ * @param Offset // offset of the field in OAHTSnapshotHeader 
+ * @param Value 
+ * @param Name 
+ * @param Path 
+ *****************************************************************************/
+static void BadHeader(size_t Offset, unsigned Value, const char *Name,
+  const char *Path)
+{
+  OAHashTable<unsigned>::OAHTConfig config(17, FNVHash);
+  OAHashTable<unsigned> table(config);
+  table.insert("one", 1);
+  table.Save(Path);
+
+  std::FILE *file = std::fopen(Path, "r+b");
+  Check(file != 0, "open snapshot", Name);
+  if (!file)
+  {
+    return;
+  }
+  std::fseek(file, static_cast<long>(Offset), SEEK_SET);
+  std::fwrite(&Value, sizeof(Value), 1, file);
+  std::fclose(file);
+
+  OAHashTable<unsigned> loaded(config);
+  bool rejected = false;
+  try
+  {
+    loaded.Load(Path);
+  }
+  catch(const OAHashTableException &e)
+  {
+    rejected = e.code() == OAHashTableException::E_SNAPSHOT;
+  }
+  Check(rejected, "Load accepted an out-of-range header", Name);
+  Check(loaded.GetStats().Count_ == 0, "table changed by a failed Load",
+    Name);
+}
+
+/******************************************************************************
+ * @brief Runs the round trip over each deletion policy with the plain,
+ *  control byte, power-of-two and compact arena layouts, then the
+ *  out-of-range header checks
+ * 
+ * @param argc 
+ * @param argv 
+ * @return int 
+ *****************************************************************************/
+int main(int argc, char *argv[])
+{
+  const char *path = argc > 1 ? argv[1] : "OAHashTable_snapshot_test.bin";
+  const char *policies[] = {"MARK", "PACK", "ROBINHOOD"};
+
+  for (unsigned policy = OAHTDeletionPolicy::MARK;
+    policy <= OAHTDeletionPolicy::ROBINHOOD; ++policy)
+  {
+    typedef OAHashTable<unsigned> Table;
+    Table::OAHTConfig config(7, FNVHash, 0, 0.7, 2.0,
+      static_cast<OAHTDeletionPolicy>(policy));
+    std::string name = policies[policy];
+    RoundTrip<Table>(config, false, (name + " plain").c_str(), path);
+
+    config.ControlBytes_ = true;
+    config.StoreHash_ = true;
+    RoundTrip<Table>(config, false, (name + " ctrl").c_str(), path);
+
+    config.CapacityPolicy_ = OAHTCapacityPolicy::POWER_OF_TWO;
+    RoundTrip<Table>(config, false, (name + " pow2").c_str(), path);
+
+    typedef OAHashTable<unsigned, OAHTStringHash, OAHTArenaKeys> ArenaTable;
+    ArenaTable::OAHTConfig arena_config(7, 0, 0, 0.7, 2.0,
+      static_cast<OAHTDeletionPolicy>(policy));
+    arena_config.ControlBytes_ = true;
+    RoundTrip<ArenaTable>(arena_config, true, (name + " arena").c_str(), path);
+  }
+
+  BadHeader(offsetof(OAHTSnapshotHeader, DeletionPolicy_), 3,
+    "DeletionPolicy_ 3", path);
+  BadHeader(offsetof(OAHTSnapshotHeader, DeletionPolicy_), 0xFFFFFFFFu,
+    "DeletionPolicy_ -1", path);
+  BadHeader(offsetof(OAHTSnapshotHeader, CapacityPolicy_), 2,
+    "CapacityPolicy_ 2", path);
+  BadHeader(offsetof(OAHTSnapshotHeader, Count_), 1000,
+    "Count_ past TableSize_", path);
+
+  std::remove(path);
+  std::printf("%s (%u failed checks)\n", failures ? "FAILED" : "PASSED",
+    failures);
+  return failures ? 1 : 0;
+}
@@ -14,6 +14,11 @@
 /******************************************************************************
  * @brief Given a sequence of integers,
  *        return the indices of the longest strictly increasing subsequence
+ *        in ascending order. Patience sorting: tails[k] holds the index of 
+ *        the smallest value that ends an increasing subsequence of length 
+ *        k + 1, found by binary search, and every element links to the 
+ *        tail it extended so the answer can be walked back from the end. 
+ *        O(n log n) time and O(n) memory.
  * 
  * @param sequence 
  * @return std::vector<unsigned> 
@@ -21,42 +26,56 @@
 std::vector<unsigned> 
 longest_increasing_subsequence(std::vector<int> const& sequence) 
 {
-    // Allocated/reserve table, init all to 0 - including init case
-    unsigned size = sequence.size();
-    std::vector<unsigned> lis(size, 0);
-    lis[0] = 1;
-
-    // Initialize return vector and variables
+    unsigned size = static_cast<unsigned>(sequence.size());
     std::vector<unsigned> answer; //vector of indices corresponding to the LIS
-    unsigned left = 0, right = 1; //pointer indices for traversing lis
+    if (size == 0)
+    {
+      return answer;
+    }
 
-    // Main logic - Populate lis
-    for (unsigned i = 1; i < size; ++i)
+    // tails is sorted by value, so each element finds its place in log time
+    std::vector<unsigned> tails;
+    std::vector<unsigned> prev(size); //index before i in its subsequence
+    tails.reserve(size);
+
+    // Main logic - Extend or improve one tail per element
+    for (unsigned i = 0; i < size; ++i)
     {
-      lis[i] = 1;
-      for (unsigned j = 0; j < i; ++j)
+      // First tail that is not smaller (strictly increasing, so equal 
+      // values replace rather than extend)
+      unsigned lo = 0, hi = static_cast<unsigned>(tails.size());
+      while (lo < hi)
       {
-        if (sequence[i] > sequence[j] && lis[i] < lis[j] + 1)
+        unsigned mid = lo + (hi - lo) / 2;
+        if (sequence[tails[mid]] < sequence[i])
+        {
+          lo = mid + 1;
+        }
+        else
         {
-          lis[i] = lis[j] + 1;
+          hi = mid;
         }
       }
-    }
 
-    // Populate return vector
-    for (; right < size; ++right)
-    {
-      if (lis[left] == lis[right])
+      prev[i] = lo > 0 ? tails[lo - 1] : i;
+      if (lo == tails.size())
       {
-        left = right;
+        tails.push_back(i);
       }
-      else if (lis[left] < lis[right])
+      else
       {
-        answer.push_back(left);
-        left = right;
+        tails[lo] = i;
       }
     }
-    answer.push_back(left);
+
+    // Populate return vector by walking the links back from the last tail
+    answer.resize(tails.size());
+    unsigned index = tails.back();
+    for (unsigned k = static_cast<unsigned>(answer.size()); k > 0; --k)
+    {
+      answer[k - 1] = index;
+      index = prev[index];
+    }
 
     return answer;
 }
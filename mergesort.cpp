@@ -9,29 +9,190 @@
  * 
  *****************************************************************************/
 #include "mergesort.h"
+#include "sortutil.h"
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
 #include <cstring>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MERGESORT_HAS_AVX2
+#include <climits>
+#include <immintrin.h>
+#endif
+
+// Blocks this short are sorted directly instead of split further
+static const unsigned SMALL_SORT_THRESHOLD = 16;
+
+// Adaptive mode: natural runs shorter than this are extended by insertion
+static const unsigned MIN_NATURAL_RUN = 16;
+
+// Adaptive mode: wins in a row that switch a merge to galloping
+static const unsigned GALLOP_THRESHOLD = 7;
+
+// Adaptive mode: single steps without a gallop before a merge hands the 
+// rest to the merge kernel
+static const unsigned GALLOP_GIVE_UP = 32;
+
+// External mode: memory budget used when the caller passes zero
+static const unsigned long long EXTERNAL_MEMORY_DEFAULT = 256ull << 20;
+
+// External mode: smallest per-run read buffer, in ints, before the merge 
+// is split into several passes
+static const unsigned long long EXTERNAL_BLOCK_MIN = 1 << 18;
+
+// Parallel mode: subarrays shorter than this are sorted on one thread
+static const unsigned PARALLEL_SORT_CUTOFF = 1 << 16;
+
+// Parallel mode: outputs shorter than this are merged on one thread
+static const unsigned PARALLEL_MERGE_CUTOFF = 1 << 16;
+
+// Merge kernel picked with set_merge_kernel. Read once per merge, so it is 
+// atomic for the parallel and external modes' worker threads.
+static std::atomic<int> merge_kernel(MERGE_AUTO);
+
+#ifdef SORT_STATS
+// Instrumentation for benchmarks, compiled in with SORT_STATS. Relaxed 
+// atomics, since the parallel and external modes update them from several 
+// threads; they are touched once per merge or run. Comparisons are counted 
+// per thread and added to stat_compares in one go (see MergesortCompares).
+static std::atomic<unsigned long long> stat_compares(0);
+static std::atomic<unsigned long long> stat_merges(0);
+static std::atomic<unsigned long long> stat_merged(0);
+static std::atomic<unsigned long long> stat_runs(0);
+static std::atomic<unsigned> stat_max_depth(0);
+
+// Comparisons made on this thread that are not in stat_compares yet. They 
+// are counted in a plain per-thread total and added in when the thread 
+// exits or an entry point returns on it.
+struct MergesortCompares
+{
+  unsigned long long count = 0;
+
+  ~MergesortCompares()
+  {
+    flush();
+  }
+
+  void flush()
+  {
+    stat_compares.fetch_add(count, std::memory_order_relaxed);
+    count = 0;
+  }
+};
+static thread_local MergesortCompares stat_compares_here;
+
+// Adds the calling thread's comparisons in when an entry point returns
+struct MergesortCall
+{
+  ~MergesortCall()
+  {
+    stat_compares_here.flush();
+  }
+};
 
 /******************************************************************************
- * @brief Merges and sorts two arrays
+ * @brief Raises the deepest merge level seen by any call to depth
  * 
- * @param start // pointer to the first element of source array
- * @param mid   // pointer to the mid element of source array
- * @param end   // pointer to the last element of source array
- * @param dest  // destination array to write
+ * @param depth
  * @return void
  *****************************************************************************/
-static void merge(int* start, int* mid, int* end, int* dest) 
+static void stat_depth(unsigned depth)
 {
-  // Initialize pointers
-  int* startL = start;
-  int* startR = mid;
-  int* endL   = mid;
-  int* endR   = end;
+  unsigned cur = stat_max_depth.load(std::memory_order_relaxed);
+  while (cur < depth && 
+    !stat_max_depth.compare_exchange_weak(cur, depth, 
+      std::memory_order_relaxed));
+}
 
+/******************************************************************************
+ * @brief Returns how many times merge_rec halves len elements before the 
+ *  blocks are short enough for small_sort. The halving does not depend on 
+ *  the data, so this is the depth of every call on len elements.
+ * 
+ * @param len
+ * @return unsigned
+ *****************************************************************************/
+static unsigned merge_depth(unsigned long long len)
+{
+  unsigned depth = 0;
+  for (; len > SMALL_SORT_THRESHOLD; len -= len / 2)
+  {
+    ++depth;
+  }
+  return depth;
+}
+
+#define STAT_CALL() MergesortCall stat_call
+#define STAT_COMPARES(n) (stat_compares_here.count += (n))
+
+#define STAT_MERGE(len) (stat_merges.fetch_add(1, std::memory_order_relaxed), \
+  stat_merged.fetch_add(len, std::memory_order_relaxed))
+#define STAT_RUN() stat_runs.fetch_add(1, std::memory_order_relaxed)
+#define STAT_DEPTH(depth) stat_depth(depth)
+#else
+#define STAT_CALL()
+#define STAT_COMPARES(n)
+#define STAT_MERGE(len)
+#define STAT_RUN()
+#define STAT_DEPTH(depth)
+#endif
+
+/******************************************************************************
+ * @brief Compares two elements. Every comparison the sorts make goes 
+ *  through here, so SORT_STATS builds can count them.
+ * 
+ * @param x
+ * @param y
+ * @return bool
+ *****************************************************************************/
+static inline bool less(int x, int y)
+{
+  STAT_COMPARES(1);
+  return x < y;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//--  MERGE KERNELS  --////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+/******************************************************************************
+ * @brief Merges and sorts two arrays with the plain two-pointer loop, one 
+ *  data-dependent branch per element. Ties are taken from the left array 
+ *  first, so the sort is stable. Only used when picked with 
+ *  set_merge_kernel, as the baseline for the other kernels.
+ * 
+ * @param startL // pointer to the first element of left array
+ * @param endL   // pointer past the last element of left array
+ * @param startR // pointer to the first element of right array
+ * @param endR   // pointer past the last element of right array
+ * @param dest   // destination array to write
+ * @return void
+ *****************************************************************************/
+static void merge_scalar(const int* startL, const int* endL, 
+  const int* startR, const int* endR, int* dest)
+{
   // Sort
   while (startL < endL && startR < endR) 
   {
-    *dest++ = *startL < *startR ? *startL++ : *startR++;
+    if (less(*startR, *startL))
+    {
+      *dest++ = *startR++;
+    }
+    else
+    {
+      *dest++ = *startL++;
+    }
   }
   while (startL < endL)
   {
@@ -43,6 +204,312 @@ static void merge(int* start, int* mid, int* end, int* dest)
   } 
 }
 
+/******************************************************************************
+ * @brief Merges and sorts two arrays without a data-dependent branch in the 
+ *  loop: the smaller head is selected and both read pointers are advanced 
+ *  by the comparison result. Ties are taken from the left array first, so 
+ *  the sort is stable.
+ * 
+ * @param startL // pointer to the first element of left array
+ * @param endL   // pointer past the last element of left array
+ * @param startR // pointer to the first element of right array
+ * @param endR   // pointer past the last element of right array
+ * @param dest   // destination array to write
+ * @return void
+ *****************************************************************************/
+static void merge_branchless(const int* startL, const int* endL, 
+  const int* startR, const int* endR, int* dest)
+{
+  // Sort
+  while (startL < endL && startR < endR) 
+  {
+    int l = *startL;
+    int r = *startR;
+    bool takeR = less(r, l);
+    *dest++ = takeR ? r : l;
+    startR += takeR;
+    startL += !takeR;
+  }
+  while (startL < endL)
+  {
+    *dest++ = *startL++;
+  } 
+  while (startR < endR)
+  {
+    *dest++ = *startR++;
+  } 
+}
+
+#ifdef MERGESORT_HAS_AVX2
+#define MERGESORT_AVX2 __attribute__((target("avx2")))
+
+/******************************************************************************
+ * @brief One compare-exchange step of a bitonic network inside a register: 
+ *  every lane is paired with the lane Dist away, and lanes set in MaxLanes 
+ *  keep the larger value of their pair.
+ * 
+ * @param x // eight ints
+ * @return __m256i
+ *****************************************************************************/
+template<int Dist, int MaxLanes>
+MERGESORT_AVX2 static inline __m256i avx2_cmpx(__m256i x)
+{
+  __m256i y;
+  if (Dist == 1)
+  {
+    y = _mm256_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1));
+  }
+  else if (Dist == 2)
+  {
+    y = _mm256_shuffle_epi32(x, _MM_SHUFFLE(1, 0, 3, 2));
+  }
+  else
+  {
+    y = _mm256_permute2x128_si256(x, x, 1);
+  }
+  STAT_COMPARES(4);
+  return _mm256_blend_epi32(_mm256_min_epi32(x, y), _mm256_max_epi32(x, y), 
+    MaxLanes);
+}
+
+/******************************************************************************
+ * @brief Sorts a bitonic register of eight ints into ascending order
+ * 
+ * @param x // eight ints forming a bitonic sequence
+ * @return __m256i
+ *****************************************************************************/
+MERGESORT_AVX2 static inline __m256i avx2_bitonic_clean(__m256i x)
+{
+  x = avx2_cmpx<4, 0xF0>(x);
+  x = avx2_cmpx<2, 0xCC>(x);
+  return avx2_cmpx<1, 0xAA>(x);
+}
+
+/******************************************************************************
+ * @brief Sorts eight ints in one register with a bitonic sorting network
+ * 
+ * @param x // eight ints
+ * @return __m256i
+ *****************************************************************************/
+MERGESORT_AVX2 static inline __m256i avx2_sort8(__m256i x)
+{
+  x = avx2_cmpx<1, 0x66>(x);
+  x = avx2_cmpx<2, 0x3C>(x);
+  x = avx2_cmpx<1, 0x5A>(x);
+  return avx2_bitonic_clean(x);
+}
+
+/******************************************************************************
+ * @brief Merges two sorted registers: afterwards lo holds the eight 
+ *  smallest values and hi the eight largest, both ascending.
+ * 
+ * @param lo // eight sorted ints, replaced by the lower half
+ * @param hi // eight sorted ints, replaced by the upper half
+ * @return void
+ *****************************************************************************/
+MERGESORT_AVX2 static inline void avx2_merge16(__m256i& lo, __m256i& hi)
+{
+  // Reversing one side makes the pair a single bitonic sequence
+  hi = _mm256_permutevar8x32_epi32(hi, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 
+    1, 0));
+  STAT_COMPARES(8);
+  __m256i mn = _mm256_min_epi32(lo, hi);
+  __m256i mx = _mm256_max_epi32(lo, hi);
+  lo = avx2_bitonic_clean(mn);
+  hi = avx2_bitonic_clean(mx);
+}
+
+/******************************************************************************
+ * @brief Sorts up to 16 ints with the AVX2 sorting network. Missing lanes 
+ *  are padded with INT_MAX so they sort to the end and are not stored.
+ * 
+ * @param a   // array to sort
+ * @param len // length of array, at most 16
+ * @return void
+ *****************************************************************************/
+MERGESORT_AVX2 static void small_sort_avx2(int* a, unsigned len)
+{
+  int buf[16];
+  for (unsigned i = 0; i < 16; ++i)
+  {
+    buf[i] = i < len ? a[i] : INT_MAX;
+  }
+
+  __m256i lo = avx2_sort8(_mm256_loadu_si256(
+    reinterpret_cast<const __m256i*>(buf)));
+  __m256i hi = avx2_sort8(_mm256_loadu_si256(
+    reinterpret_cast<const __m256i*>(buf + 8)));
+  avx2_merge16(lo, hi);
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(buf), lo);
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(buf + 8), hi);
+  memcpy(a, buf, sizeof(int) * len);
+}
+
+/******************************************************************************
+ * @brief Merges two arrays eight elements at a time with a bitonic merge 
+ *  network. hi carries the eight largest values seen so far; each step 
+ *  loads the next block from whichever array has the smaller head, merges 
+ *  it with hi and stores the lower eight. When that array has fewer than 
+ *  eight elements left, hi and the short remainder are merged into a 
+ *  small buffer and the buffer is merged with the rest of the other array.
+ * 
+ * @param startL // pointer to the first element of left array
+ * @param endL   // pointer past the last element of left array
+ * @param startR // pointer to the first element of right array
+ * @param endR   // pointer past the last element of right array
+ * @param dest   // destination array to write
+ * @return void
+ *****************************************************************************/
+MERGESORT_AVX2 static void merge_avx2(const int* startL, const int* endL, 
+  const int* startR, const int* endR, int* dest)
+{
+  if (endL - startL < 8 || endR - startR < 8)
+  {
+    merge_branchless(startL, endL, startR, endR, dest);
+    return;
+  }
+
+  __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(startL));
+  __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(startR));
+  startL += 8;
+  startR += 8;
+
+  bool takeL;
+  for (;;)
+  {
+    avx2_merge16(lo, hi);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest), lo);
+    dest += 8;
+
+    takeL = startR == endR || (startL < endL && !less(*startR, *startL));
+    const int*& next = takeL ? startL : startR;
+    const int* nextEnd = takeL ? endL : endR;
+    if (nextEnd - next < 8)
+    {
+      break;
+    }
+    lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(next));
+    next += 8;
+  }
+
+  // Merge hi with the short remainder, then the result with the other array
+  int carry[8];
+  int buf[16];
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(carry), hi);
+  const int* shortStart = takeL ? startL : startR;
+  const int* shortEnd = takeL ? endL : endR;
+  merge_branchless(carry, carry + 8, shortStart, shortEnd, buf);
+  int* bufEnd = buf + 8 + (shortEnd - shortStart);
+  if (takeL)
+  {
+    merge_branchless(buf, bufEnd, startR, endR, dest);
+  }
+  else
+  {
+    merge_branchless(startL, endL, buf, bufEnd, dest);
+  }
+}
+#endif
+
+/******************************************************************************
+ * @brief Reports whether the AVX2 kernels can run on this CPU. Checked once.
+ * 
+ * @return bool
+ *****************************************************************************/
+static bool have_avx2()
+{
+#ifdef MERGESORT_HAS_AVX2
+  static const bool supported = __builtin_cpu_supports("avx2");
+  return supported;
+#else
+  return false;
+#endif
+}
+
+/******************************************************************************
+ * @brief Reports whether the AVX2 kernels should run: the CPU supports them 
+ *  and set_merge_kernel has not picked a scalar kernel
+ * 
+ * @return bool
+ *****************************************************************************/
+static bool use_avx2()
+{
+  int kernel = merge_kernel.load(std::memory_order_relaxed);
+  return (kernel == MERGE_AUTO || kernel == MERGE_AVX2) && have_avx2();
+}
+
+/******************************************************************************
+ * @brief Merges and sorts two arrays, with the AVX2 merge network when the 
+ *  CPU supports it and the branchless scalar loop otherwise, unless 
+ *  set_merge_kernel picked a kernel.
+ * 
+ * @param startL // pointer to the first element of left array
+ * @param endL   // pointer past the last element of left array
+ * @param startR // pointer to the first element of right array
+ * @param endR   // pointer past the last element of right array
+ * @param dest   // destination array to write
+ * @return void
+ *****************************************************************************/
+static void merge(const int* startL, const int* endL, const int* startR, 
+  const int* endR, int* dest) 
+{
+#ifdef MERGESORT_HAS_AVX2
+  if (use_avx2())
+  {
+    merge_avx2(startL, endL, startR, endR, dest);
+    return;
+  }
+#endif
+  if (merge_kernel.load(std::memory_order_relaxed) == MERGE_SCALAR)
+  {
+    merge_scalar(startL, endL, startR, endR, dest);
+    return;
+  }
+  merge_branchless(startL, endL, startR, endR, dest);
+}
+
+/******************************************************************************
+ * @brief Sorts a block of at most SMALL_SORT_THRESHOLD ints in place, with 
+ *  the AVX2 sorting network when the AVX2 kernels are in use and insertion 
+ *  sort otherwise.
+ * 
+ * @param a   // array to sort
+ * @param len // length of array
+ * @return void
+ *****************************************************************************/
+static void small_sort(int* a, unsigned len)
+{
+#ifdef MERGESORT_HAS_AVX2
+  if (use_avx2())
+  {
+    small_sort_avx2(a, len);
+    return;
+  }
+#endif
+  insertion_sort(a, a + len, less);
+}
+
+/******************************************************************************
+ * @brief Picks the merge kernel every merge sort entry point uses from now 
+ *  on: MERGE_SCALAR (the two-pointer loop), MERGE_BRANCHLESS, MERGE_AVX2 
+ *  (the merge network and the sorting network base case) or MERGE_AUTO, 
+ *  the default, which takes AVX2 when the CPU has it. Meant for benchmarks 
+ *  comparing the kernels; do not call it while a sort is running. Returns 
+ *  false, leaving the kernel alone, if the kernel cannot run on this CPU.
+ * 
+ * @param kernel // a MergeKernel
+ * @return bool
+ *****************************************************************************/
+bool set_merge_kernel(MergeKernel kernel)
+{
+  if (kernel == MERGE_AVX2 && !have_avx2())
+  {
+    return false;
+  }
+  merge_kernel.store(kernel, std::memory_order_relaxed);
+  return true;
+}
+
 /******************************************************************************
  * @brief Auxiliary recursive function for merge sort
  * 
@@ -51,20 +518,23 @@ static void merge(int* start, int* mid, int* end, int* dest)
  * @param len   // length of source array
  * @return void
  *****************************************************************************/
-static void merge_rec(int* src, int* dest, unsigned len)
+static void merge_rec(int* src, int* dest, unsigned long long len)
 {
-  if (len < 2) 
+  // src and dest hold the same values here, so short blocks sort in dest
+  if (len <= SMALL_SORT_THRESHOLD) 
   {
+    small_sort(dest, static_cast<unsigned>(len));
     return;
   }
 
   // Call merge_rec on first half and second half
-  unsigned l_len = len / 2;
+  unsigned long long l_len = len / 2;
   merge_rec(dest, src, l_len);
   merge_rec(dest + l_len, src + l_len, len - l_len);
 
   // Merge the two halves
-  merge(src, src + l_len, src + len, dest);
+  STAT_MERGE(len);
+  merge(src, src + l_len, src + l_len, src + len, dest);
 }
 
 /******************************************************************************
@@ -76,14 +546,973 @@ static void merge_rec(int* src, int* dest, unsigned len)
  *****************************************************************************/
 void mergesort(int* a, unsigned r)
 {
+  STAT_CALL();
   if (r <= 1) 
   {
     return;
   }
 
   // Allocate array once, merge, then delete
+  STAT_DEPTH(merge_depth(r));
   int* left = new int[r];
   memcpy(left, a, sizeof(int) * r);
   merge_rec(left, a, r);
   delete [] left;
-}
\ No newline at end of file
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//--  PARALLEL MODE  --////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+/******************************************************************************
+ * @brief Co-rank (merge path) search: returns how many of the first k 
+ *  outputs of a stable merge come from the left array. The rest, k minus 
+ *  the result, come from the right array.
+ * 
+ * @param startL // pointer to the first element of left array
+ * @param lenL   // length of left array
+ * @param startR // pointer to the first element of right array
+ * @param lenR   // length of right array
+ * @param k      // number of outputs
+ * @return unsigned
+ *****************************************************************************/
+static unsigned co_rank(const int* startL, unsigned lenL, const int* startR, 
+  unsigned lenR, unsigned k)
+{
+  unsigned lo = k > lenR ? k - lenR : 0;
+  unsigned hi = k < lenL ? k : lenL;
+
+  // Find the first i for which left[i] no longer comes before right[k-i-1]
+  while (lo < hi)
+  {
+    unsigned i = lo + (hi - lo) / 2;
+    unsigned j = k - i;
+    if (j > 0 && !less(startR[j - 1], startL[i]))
+    {
+      lo = i + 1;
+    }
+    else
+    {
+      hi = i;
+    }
+  }
+  return lo;
+}
+
+/******************************************************************************
+ * @brief Merges two sorted arrays on several threads. The output is cut 
+ *  into equal chunks and co_rank finds where each chunk starts in both 
+ *  inputs, so every thread runs an ordinary merge on its own chunk.
+ * 
+ * @param startL  // pointer to the first element of left array
+ * @param endL    // pointer past the last element of left array
+ * @param startR  // pointer to the first element of right array
+ * @param endR    // pointer past the last element of right array
+ * @param dest    // destination array to write
+ * @param threads // number of threads to use
+ * @return void
+ *****************************************************************************/
+static void parallel_merge(int* startL, int* endL, int* startR, int* endR, 
+  int* dest, unsigned threads)
+{
+  unsigned lenL = static_cast<unsigned>(endL - startL);
+  unsigned lenR = static_cast<unsigned>(endR - startR);
+  unsigned len = lenL + lenR;
+
+  if (threads > len / PARALLEL_MERGE_CUTOFF)
+  {
+    threads = len / PARALLEL_MERGE_CUTOFF;
+  }
+  if (threads < 2)
+  {
+    merge(startL, endL, startR, endR, dest);
+    return;
+  }
+
+  run_parallel(threads, [&](unsigned t)
+  {
+    unsigned k0 = static_cast<unsigned>(
+      static_cast<unsigned long long>(len) * t / threads);
+    unsigned k1 = static_cast<unsigned>(
+      static_cast<unsigned long long>(len) * (t + 1) / threads);
+    unsigned i0 = co_rank(startL, lenL, startR, lenR, k0);
+    unsigned i1 = co_rank(startL, lenL, startR, lenR, k1);
+
+    merge(startL + i0, startL + i1, startR + (k0 - i0), startR + (k1 - i1), 
+      dest + k0);
+  });
+}
+
+/******************************************************************************
+ * @brief Auxiliary recursive function for parallel merge sort. Same 
+ *  ping-pong between src and dest as merge_rec, but the halves are sorted 
+ *  at the same time and then merged by all of their threads.
+ * 
+ * @param src     // source array to read
+ * @param dest    // destination array to write
+ * @param len     // length of source array
+ * @param threads // number of threads to use
+ * @return void
+ *****************************************************************************/
+static void parallel_merge_rec(int* src, int* dest, unsigned len, 
+  unsigned threads)
+{
+  if (threads < 2 || len < PARALLEL_SORT_CUTOFF) 
+  {
+    merge_rec(src, dest, len);
+    return;
+  }
+
+  // Sort the first half on a new thread and the second half on this one
+  unsigned l_len = len / 2;
+  unsigned l_threads = threads / 2;
+  std::thread left;
+  try
+  {
+    left = std::thread(parallel_merge_rec, dest, src, l_len, l_threads);
+  }
+  catch(const std::system_error&)
+  {
+    parallel_merge_rec(dest, src, l_len, l_threads);
+  }
+  parallel_merge_rec(dest + l_len, src + l_len, len - l_len, 
+    threads - l_threads);
+  if (left.joinable())
+  {
+    left.join();
+  }
+
+  // Merge the two halves
+  STAT_MERGE(len);
+  parallel_merge(src, src + l_len, src + l_len, src + len, dest, threads);
+}
+
+/******************************************************************************
+ * @brief Conducts merge sort on threads threads (zero uses every core). 
+ *  Uses the same single scratch allocation as mergesort.
+ * 
+ * @param a       // destination array
+ * @param r       // length of array
+ * @param threads // number of threads to use
+ * @return void
+ *****************************************************************************/
+void parallel_mergesort(int* a, unsigned r, unsigned threads)
+{
+  STAT_CALL();
+  if (r <= 1) 
+  {
+    return;
+  }
+  if (threads == 0)
+  {
+    threads = std::thread::hardware_concurrency();
+  }
+
+  // Allocate array once, merge, then delete
+  STAT_DEPTH(merge_depth(r));
+  int* left = new int[r];
+  memcpy(left, a, sizeof(int) * r);
+  parallel_merge_rec(left, a, r, threads);
+  delete [] left;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//--  ADAPTIVE MODE  --////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+// A sorted run waiting on the merge stack, with the power of the boundary 
+// between it and the run above it
+struct NaturalRun
+{
+  unsigned start;
+  unsigned len;
+  int power;
+};
+
+/******************************************************************************
+ * @brief Galloping search: returns how many elements of a[0, len) are no 
+ *  greater than key. Probes 1, 3, 7, ... elements in, then binary searches 
+ *  the last gap, so the cost grows with the log of the answer.
+ * 
+ * @param key // value to place
+ * @param a   // sorted array
+ * @param len // length of array
+ * @return unsigned
+ *****************************************************************************/
+static unsigned gallop_right(int key, const int* a, unsigned len)
+{
+  unsigned lo = 0;
+  unsigned hi = 1;
+  while (hi <= len && !less(key, a[hi - 1]))
+  {
+    lo = hi;
+    hi = 2 * hi + 1;
+  }
+  if (hi > len)
+  {
+    hi = len;
+  }
+
+  while (lo < hi)
+  {
+    unsigned mid = lo + (hi - lo) / 2;
+    if (less(key, a[mid]))
+    {
+      hi = mid;
+    }
+    else
+    {
+      lo = mid + 1;
+    }
+  }
+  return lo;
+}
+
+/******************************************************************************
+ * @brief Galloping search: returns how many elements of a[0, len) are 
+ *  smaller than key
+ * 
+ * @param key // value to place
+ * @param a   // sorted array
+ * @param len // length of array
+ * @return unsigned
+ *****************************************************************************/
+static unsigned gallop_left(int key, const int* a, unsigned len)
+{
+  unsigned lo = 0;
+  unsigned hi = 1;
+  while (hi <= len && less(a[hi - 1], key))
+  {
+    lo = hi;
+    hi = 2 * hi + 1;
+  }
+  if (hi > len)
+  {
+    hi = len;
+  }
+
+  while (lo < hi)
+  {
+    unsigned mid = lo + (hi - lo) / 2;
+    if (less(a[mid], key))
+    {
+      lo = mid + 1;
+    }
+    else
+    {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+/******************************************************************************
+ * @brief Merges the adjacent sorted runs a[0, lenL) and a[lenL, lenL + 
+ *  lenR) in place. The part of the left run already below the right run 
+ *  and the part of the right run already above the left run are skipped 
+ *  by galloping, so nearly ordered runs cost little more than the search. 
+ *  What is left of the left run is copied to scratch and merged back from 
+ *  the front; once one side wins GALLOP_THRESHOLD times in a row, its 
+ *  whole winning stretch is found by galloping and moved as a block. If 
+ *  GALLOP_GIVE_UP steps pass without a gallop, the rest goes to merge. 
+ *  Ties are taken from the left run first, so the sort is stable.
+ * 
+ * @param a       // first element of the left run
+ * @param lenL    // length of left run
+ * @param lenR    // length of right run
+ * @param scratch // space for at least lenL ints
+ * @return void
+ *****************************************************************************/
+static void merge_gallop(int* a, unsigned lenL, unsigned lenR, int* scratch)
+{
+  STAT_MERGE(lenL + lenR);
+  int* startR = a + lenL;
+  unsigned k = gallop_right(*startR, a, lenL);
+  a += k;
+  lenL -= k;
+  if (lenL == 0)
+  {
+    return;
+  }
+  lenR = gallop_left(a[lenL - 1], startR, lenR);
+  if (lenR == 0)
+  {
+    return;
+  }
+
+  memcpy(scratch, a, sizeof(int) * lenL);
+  const int* startL = scratch;
+  const int* endL = scratch + lenL;
+  const int* endR = startR + lenR;
+  int* dest = a;
+  unsigned winsL = 0;
+  unsigned winsR = 0;
+  unsigned steps = 0;
+
+  while (startL < endL && startR < endR)
+  {
+    // No stretches worth galloping over: finish with the fast kernel, 
+    // which never writes past the right run's read position
+    if (++steps > GALLOP_GIVE_UP)
+    {
+      merge(startL, endL, startR, endR, dest);
+      return;
+    }
+
+    if (less(*startR, *startL))
+    {
+      *dest++ = *startR++;
+      ++winsR;
+      winsL = 0;
+    }
+    else
+    {
+      *dest++ = *startL++;
+      ++winsL;
+      winsR = 0;
+    }
+
+    if (startL == endL || startR == endR)
+    {
+      break;
+    }
+    if (winsL >= GALLOP_THRESHOLD)
+    {
+      unsigned run = gallop_right(*startR, startL, 
+        static_cast<unsigned>(endL - startL));
+      memcpy(dest, startL, sizeof(int) * run);
+      dest += run;
+      startL += run;
+      winsL = 0;
+      steps = 0;
+    }
+    else if (winsR >= GALLOP_THRESHOLD)
+    {
+      // dest trails startR, so the block may overlap its new position
+      unsigned run = gallop_left(*startL, startR, 
+        static_cast<unsigned>(endR - startR));
+      memmove(dest, startR, sizeof(int) * run);
+      dest += run;
+      startR += run;
+      winsR = 0;
+      steps = 0;
+    }
+  }
+
+  // Whatever is left of the right run is already in place
+  memcpy(dest, startL, sizeof(int) * (endL - startL));
+}
+
+/******************************************************************************
+ * @brief Finds the natural run starting at a[start]: the longest 
+ *  non-descending stretch, or strictly descending stretch, which is 
+ *  reversed in place. Runs shorter than MIN_NATURAL_RUN are extended with
+ *  small_sort. Returns the run's length.
+ * 
+ * @param a     // array to scan
+ * @param start // first element of the run
+ * @param r     // length of array
+ * @return unsigned
+ *****************************************************************************/
+static unsigned natural_run(int* a, unsigned start, unsigned r)
+{
+  STAT_RUN();
+  unsigned end = start + 1;
+  if (end < r)
+  {
+    if (less(a[end], a[start]))
+    {
+      // Strict, so reversing never reorders equal keys
+      while (end < r && less(a[end], a[end - 1]))
+      {
+        ++end;
+      }
+      for (unsigned i = start, j = end - 1; i < j; ++i, --j)
+      {
+        int t = a[i];
+        a[i] = a[j];
+        a[j] = t;
+      }
+    }
+    else
+    {
+      while (end < r && !less(a[end], a[end - 1]))
+      {
+        ++end;
+      }
+    }
+  }
+
+  if (end - start < MIN_NATURAL_RUN && end < r)
+  {
+    end = r - start < MIN_NATURAL_RUN ? r : start + MIN_NATURAL_RUN;
+    small_sort(a + start, end - start);
+  }
+  return end - start;
+}
+
+/******************************************************************************
+ * @brief Powersort merge priority of the boundary between two adjacent 
+ *  runs: the first bit at which the binary fractions of their midpoints, 
+ *  taken relative to r, differ. Merging boundaries of higher power first 
+ *  keeps the merge tree nearly balanced.
+ * 
+ * @param startL // first element of the left run
+ * @param lenL   // length of left run
+ * @param lenR   // length of right run
+ * @param r      // length of array
+ * @return int
+ *****************************************************************************/
+static int run_power(unsigned startL, unsigned lenL, unsigned lenR, 
+  unsigned r)
+{
+  // Twice the midpoints, so everything stays in integers
+  unsigned long long a = 2ull * startL + lenL;
+  unsigned long long b = a + lenL + lenR;
+  int power = 0;
+  for (;;)
+  {
+    ++power;
+    if (a >= r)
+    {
+      a -= r;
+      b -= r;
+    }
+    else if (b >= r)
+    {
+      break;
+    }
+    a <<= 1;
+    b <<= 1;
+  }
+  return power;
+}
+
+/******************************************************************************
+ * @brief Conducts adaptive (natural) merge sort. Existing ascending and 
+ *  descending runs are found and merged in powersort order with galloping 
+ *  merges, so sorted, reversed and nearly sorted input take close to linear 
+ *  time while random input stays O(n log n). Uses one scratch allocation, 
+ *  made on the first merge that needs it, and is stable.
+ * 
+ * @param a   // destination array
+ * @param r   // length of array
+ * @return void
+ *****************************************************************************/
+void adaptive_mergesort(int* a, unsigned r)
+{
+  STAT_CALL();
+  if (r <= 1) 
+  {
+    return;
+  }
+
+  // Run powers strictly increase up the stack, so it never outgrows the 
+  // number of bits in a length
+  NaturalRun stack[sizeof(unsigned) * 8 + 2];
+  unsigned height = 0;
+  int* scratch = 0;
+
+  auto merge_top = [&]()
+  {
+    NaturalRun& left = stack[height - 2];
+    NaturalRun& right = stack[height - 1];
+    if (!scratch)
+    {
+      scratch = new int[r];
+    }
+    merge_gallop(a + left.start, left.len, right.len, scratch);
+    left.len += right.len;
+    --height;
+  };
+
+  for (unsigned start = 0; start < r; )
+  {
+    NaturalRun run = { start, natural_run(a, start, r), 0 };
+    start += run.len;
+
+    if (height > 0)
+    {
+      NaturalRun& top = stack[height - 1];
+      int power = run_power(top.start, top.len, run.len, r);
+      while (height > 1 && stack[height - 2].power > power)
+      {
+        merge_top();
+      }
+      stack[height - 1].power = power;
+    }
+    stack[height++] = run;
+    STAT_DEPTH(height);
+  }
+
+  while (height > 1)
+  {
+    merge_top();
+  }
+  delete [] scratch;
+}
+
+#ifndef _WIN32
+///////////////////////////////////////////////////////////////////////////////
+//--  EXTERNAL MODE  --////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+// A sorted run in a spill file, in elements
+struct ExternalRun
+{
+  unsigned long long offset;
+  unsigned long long len;
+};
+
+// Closes a file descriptor when it goes out of scope
+struct ExternalFile
+{
+  int fd;
+
+  explicit ExternalFile(int fd_) : fd(fd_) {}
+  ~ExternalFile()
+  {
+    if (fd >= 0)
+    {
+      close(fd);
+    }
+  }
+};
+
+/******************************************************************************
+ * @brief Throws the current errno as a std::system_error
+ * 
+ * @param what // what was being attempted
+ * @return void
+ *****************************************************************************/
+static void throw_errno(const char* what)
+{
+  throw std::system_error(errno, std::generic_category(), what);
+}
+
+/******************************************************************************
+ * @brief Reads exactly len ints at element offset offset, retrying short 
+ *  reads. Throws std::system_error on failure or an early end of file.
+ * 
+ * @param fd     // file to read
+ * @param dest   // destination array to write
+ * @param len    // number of ints
+ * @param offset // position in the file, in ints
+ * @return void
+ *****************************************************************************/
+static void read_ints(int fd, int* dest, unsigned long long len, 
+  unsigned long long offset)
+{
+  char* out = reinterpret_cast<char*>(dest);
+  unsigned long long left = len * sizeof(int);
+  off_t at = static_cast<off_t>(offset * sizeof(int));
+  while (left)
+  {
+    ssize_t got = pread(fd, out, left < (1u << 30) ? left : (1u << 30), at);
+    if (got < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    if (got <= 0)
+    {
+      if (got == 0)
+      {
+        errno = EIO;
+      }
+      throw_errno("external_mergesort: read failed");
+    }
+    out += got;
+    at += got;
+    left -= static_cast<unsigned long long>(got);
+  }
+}
+
+/******************************************************************************
+ * @brief Writes exactly len ints at element offset offset, retrying short 
+ *  writes. Throws std::system_error on failure.
+ * 
+ * @param fd     // file to write
+ * @param src    // source array to read
+ * @param len    // number of ints
+ * @param offset // position in the file, in ints
+ * @return void
+ *****************************************************************************/
+static void write_ints(int fd, const int* src, unsigned long long len, 
+  unsigned long long offset)
+{
+  const char* in = reinterpret_cast<const char*>(src);
+  unsigned long long left = len * sizeof(int);
+  off_t at = static_cast<off_t>(offset * sizeof(int));
+  while (left)
+  {
+    ssize_t put = pwrite(fd, in, left < (1u << 30) ? left : (1u << 30), at);
+    if (put < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    if (put <= 0)
+    {
+      throw_errno("external_mergesort: write failed");
+    }
+    in += put;
+    at += put;
+    left -= static_cast<unsigned long long>(put);
+  }
+}
+
+/******************************************************************************
+ * @brief Creates an anonymous spill file in dir. The name is unlinked at 
+ *  once, so the space is given back even if the sort never finishes.
+ * 
+ * @param dir // directory for the file
+ * @return int
+ *****************************************************************************/
+static int spill_file(const std::string& dir)
+{
+  std::string path = dir + "/mergesort.XXXXXX";
+  int fd = mkstemp(&path[0]);
+  if (fd < 0)
+  {
+    throw_errno("external_mergesort: cannot create a spill file");
+  }
+  unlink(path.c_str());
+#ifdef POSIX_FADV_SEQUENTIAL
+  posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+  return fd;
+}
+
+// One input of a k-way merge: a run read through its own buffer
+struct MergeSource
+{
+  int* buf;
+  int* cur;
+  int* end;
+  unsigned long long next;
+  unsigned long long left;
+  bool done;
+};
+
+/******************************************************************************
+ * @brief k-way merge of runs with a loser tree. Each run streams through 
+ *  a read buffer of block ints, asking the kernel to read ahead the block 
+ *  after it, and the output goes out in blocks of the same size.
+ * 
+ * @param in     // file holding the runs
+ * @param runs   // first run to merge
+ * @param k      // number of runs to merge
+ * @param out    // file to write
+ * @param offset // where the merged run starts in out, in ints
+ * @param memory // buffer space, at least (k + 1) * block ints
+ * @param block  // ints per buffer
+ * @return void
+ *****************************************************************************/
+static void merge_runs(int in, const ExternalRun* runs, unsigned k, int out, 
+  unsigned long long offset, int* memory, unsigned long long block)
+{
+  std::vector<MergeSource> src(k);
+  int* dest = memory + k * block;
+  unsigned long long used = 0;
+#ifdef SORT_STATS
+  unsigned long long total = 0;
+  for (unsigned i = 0; i < k; ++i)
+  {
+    total += runs[i].len;
+  }
+  STAT_MERGE(total);
+#endif
+
+  // Refills a source's buffer and hints the kernel about the next block
+  auto refill = [&](MergeSource& s)
+  {
+    unsigned long long len = s.left < block ? s.left : block;
+    if (len == 0)
+    {
+      s.done = true;
+      return;
+    }
+    read_ints(in, s.buf, len, s.next);
+    s.cur = s.buf;
+    s.end = s.buf + len;
+    s.next += len;
+    s.left -= len;
+#ifdef POSIX_FADV_WILLNEED
+    if (s.left)
+    {
+      unsigned long long ahead = s.left < block ? s.left : block;
+      posix_fadvise(in, static_cast<off_t>(s.next * sizeof(int)), 
+        static_cast<off_t>(ahead * sizeof(int)), POSIX_FADV_WILLNEED);
+    }
+#endif
+  };
+
+  for (unsigned i = 0; i < k; ++i)
+  {
+    src[i].buf = memory + i * block;
+    src[i].next = runs[i].offset;
+    src[i].left = runs[i].len;
+    src[i].done = false;
+    refill(src[i]);
+  }
+
+  // Finished runs lose to everything; ties go to the earlier run
+  auto wins = [&](unsigned a, unsigned b)
+  {
+    if (src[a].done || src[b].done)
+    {
+      return !src[a].done;
+    }
+    return less(*src[a].cur, *src[b].cur) || 
+      (!less(*src[b].cur, *src[a].cur) && a < b);
+  };
+
+  // tree[0] is the winner and tree[1, k) hold the losers of each match; 
+  // run i sits at leaf k + i
+  std::vector<unsigned> tree(k > 1 ? k : 1);
+  std::vector<unsigned> winner(2 * k);
+  for (unsigned i = 0; i < k; ++i)
+  {
+    winner[k + i] = i;
+  }
+  for (unsigned node = k - 1; node > 0; --node)
+  {
+    unsigned a = winner[2 * node];
+    unsigned b = winner[2 * node + 1];
+    bool a_wins = wins(a, b);
+    winner[node] = a_wins ? a : b;
+    tree[node] = a_wins ? b : a;
+  }
+  tree[0] = winner[k > 1 ? 1 : k];
+
+  for (;;)
+  {
+    unsigned w = tree[0];
+    MergeSource& s = src[w];
+    if (s.done)
+    {
+      break;
+    }
+
+    dest[used++] = *s.cur++;
+    if (used == block)
+    {
+      write_ints(out, dest, used, offset);
+      offset += used;
+      used = 0;
+    }
+    if (s.cur == s.end)
+    {
+      refill(s);
+    }
+
+    // Replay the matches on the way from w's leaf to the root
+    for (unsigned node = (k + w) / 2; node > 0; node /= 2)
+    {
+      if (wins(tree[node], w))
+      {
+        unsigned t = tree[node];
+        tree[node] = w;
+        w = t;
+      }
+    }
+    tree[0] = w;
+  }
+  write_ints(out, dest, used, offset);
+}
+
+/******************************************************************************
+ * @brief Sorts a file of native ints into output using about memory bytes 
+ *  of RAM (zero picks a default), so the input can be far larger than 
+ *  memory. Runs of half the budget are sorted with merge_rec, using the 
+ *  other half as its scratch array, and spilled to a file in temp_dir 
+ *  (null uses TMPDIR or /tmp). The runs are then combined with a loser 
+ *  tree k-way merge through large sequential reads and writes; if there 
+ *  are too many runs for useful buffers, groups of them are merged into 
+ *  longer runs first. Lengths and offsets are 64-bit throughout. Input and 
+ *  output may be the same file. Throws std::system_error on I/O failure.
+ * 
+ * @param input    // path of the file to sort
+ * @param output   // path of the sorted file to write
+ * @param memory   // memory budget in bytes
+ * @param temp_dir // directory for spill files
+ * @return void
+ *****************************************************************************/
+void external_mergesort(const char* input, const char* output, 
+  unsigned long long memory, const char* temp_dir)
+{
+  STAT_CALL();
+  if (memory == 0)
+  {
+    memory = EXTERNAL_MEMORY_DEFAULT;
+  }
+  std::string dir = temp_dir ? temp_dir : "";
+  if (dir.empty())
+  {
+    const char* env = getenv("TMPDIR");
+    dir = env && *env ? env : "/tmp";
+  }
+
+  ExternalFile in(open(input, O_RDONLY));
+  if (in.fd < 0)
+  {
+    throw_errno("external_mergesort: cannot open the input");
+  }
+  struct stat info;
+  if (fstat(in.fd, &info) != 0)
+  {
+    throw_errno("external_mergesort: cannot read the input size");
+  }
+  if (info.st_size % sizeof(int))
+  {
+    errno = EINVAL;
+    throw_errno("external_mergesort: input is not a whole number of ints");
+  }
+#ifdef POSIX_FADV_SEQUENTIAL
+  posix_fadvise(in.fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+  unsigned long long n = static_cast<unsigned long long>(info.st_size) / 
+    sizeof(int);
+
+  // One allocation: run plus scratch while sorting, merge buffers later
+  unsigned long long run_len = memory / (2 * sizeof(int));
+  if (run_len < EXTERNAL_BLOCK_MIN)
+  {
+    run_len = EXTERNAL_BLOCK_MIN;
+  }
+  if (run_len > n)
+  {
+    run_len = n ? n : 1;
+  }
+  std::vector<int> memory_buf(2 * run_len);
+  int* a = memory_buf.data();
+  int* scratch = a + run_len;
+
+  // Small enough for one run: sort in memory and write the output directly
+  if (n <= run_len)
+  {
+    STAT_DEPTH(merge_depth(n));
+    read_ints(in.fd, a, n, 0);
+    memcpy(scratch, a, sizeof(int) * n);
+    merge_rec(scratch, a, n);
+    ExternalFile out(open(output, O_WRONLY | O_CREAT | O_TRUNC, 0644));
+    if (out.fd < 0)
+    {
+      throw_errno("external_mergesort: cannot create the output");
+    }
+    write_ints(out.fd, a, n, 0);
+    return;
+  }
+
+  // Sort runs and spill them
+  ExternalFile spill(spill_file(dir));
+  std::vector<ExternalRun> runs;
+  for (unsigned long long at = 0; at < n; at += run_len)
+  {
+    unsigned long long len = n - at < run_len ? n - at : run_len;
+    read_ints(in.fd, a, len, at);
+    memcpy(scratch, a, sizeof(int) * len);
+    merge_rec(scratch, a, len);
+    write_ints(spill.fd, a, len, at);
+    ExternalRun run = { at, len };
+    runs.push_back(run);
+    STAT_RUN();
+  }
+
+  // Merge groups into longer runs until one pass can take them all
+  unsigned long long total = 2 * run_len;
+  unsigned long long fan_in = total / EXTERNAL_BLOCK_MIN - 1;
+  if (fan_in < 2)
+  {
+    fan_in = 2;
+  }
+  ExternalFile spare(-1);
+  int from = spill.fd;
+#ifdef SORT_STATS
+  unsigned levels = merge_depth(run_len) + 1;
+#endif
+  while (runs.size() > fan_in)
+  {
+#ifdef SORT_STATS
+    ++levels;
+#endif
+    if (spare.fd < 0)
+    {
+      spare.fd = spill_file(dir);
+    }
+    int to = from == spill.fd ? spare.fd : spill.fd;
+
+    std::vector<ExternalRun> merged;
+    for (size_t i = 0; i < runs.size(); i += fan_in)
+    {
+      unsigned k = static_cast<unsigned>(
+        runs.size() - i < fan_in ? runs.size() - i : fan_in);
+      ExternalRun run = { runs[i].offset, 0 };
+      for (unsigned j = 0; j < k; ++j)
+      {
+        run.len += runs[i + j].len;
+      }
+      merge_runs(from, &runs[i], k, to, run.offset, a, total / (k + 1));
+      merged.push_back(run);
+    }
+    runs.swap(merged);
+    from = to;
+  }
+
+  STAT_DEPTH(levels);
+
+  // Final pass straight into the output
+  ExternalFile out(open(output, O_WRONLY | O_CREAT | O_TRUNC, 0644));
+  if (out.fd < 0)
+  {
+    throw_errno("external_mergesort: cannot create the output");
+  }
+  unsigned k = static_cast<unsigned>(runs.size());
+  merge_runs(from, runs.data(), k, out.fd, 0, a, total / (k + 1));
+}
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+//--  STATISTICS  --///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+/******************************************************************************
+ * @brief Returns what the merge sort entry points have done since the last 
+ *  reset_mergesort_stats: merges made, elements they wrote, runs found 
+ *  (natural runs in adaptive mode, spilled runs in external mode), 
+ *  element comparisons (an AVX2 min/max pair counts one per lane pair) 
+ *  and the deepest merge level any one call reached (the run stack height 
+ *  in adaptive mode; in external mode the levels of the in-memory run 
+ *  sort plus the passes over the file). All zero unless built with 
+ *  SORT_STATS.
+ * 
+ * @return MergesortStats
+ *****************************************************************************/
+MergesortStats mergesort_stats()
+{
+  MergesortStats stats;
+#ifdef SORT_STATS
+  stats.Merges_ = stat_merges.load();
+  stats.Merged_ = stat_merged.load();
+  stats.Runs_ = stat_runs.load();
+  stats.Compares_ = stat_compares.load();
+  stats.MaxDepth_ = stat_max_depth.load();
+#endif
+  return stats;
+}
+
+/******************************************************************************
+ * @brief Zeroes the counters returned by mergesort_stats
+ * 
+ * @return void
+ *****************************************************************************/
+void reset_mergesort_stats()
+{
+#ifdef SORT_STATS
+  stat_merges.store(0);
+  stat_merged.store(0);
+  stat_runs.store(0);
+  stat_compares.store(0);
+  stat_compares_here.count = 0;
+  stat_max_depth.store(0);
+#endif
+}
@@ -0,0 +1,131 @@
+/******************************************************************************
+ * @file mergesort_parallel_test.cpp
+ * @author Jay Sharma
+ * @brief Differential test for parallel_mergesort. Sorts random, few
+ *  distinct, sorted, reversed and organ pipe inputs of sizes on both sides
+ *  of the parallel sort and merge cutoffs with several thread counts, and
+ *  checks each result against std::stable_sort of the same input and
+ *  against mergesort. Prints one line per failed check and returns
+ *  non-zero if there were any.
+ * 
+ *  Usage: mergesort_parallel_test
+ * @version 0.1
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ *****************************************************************************/
+#include "mergesort.h"
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Input patterns, in the order fill_pattern takes them
+enum Pattern {RANDOM, FEW_DISTINCT, SORTED, REVERSED, ORGAN_PIPE,
+  PATTERN_COUNT};
+static const char* const PATTERN_NAMES[] = {"random", "few_distinct",
+  "sorted", "reversed", "organ_pipe"};
+
+// Sizes under test: tiny, around the sort and merge cutoffs (1 << 16) and
+// large enough to split several times
+static const unsigned SIZES[] = {0, 1, 2, 17, 1000, (1 << 16) - 1,
+  (1 << 16) + 1, (1 << 17) + 3, 500009, (1 << 21) + 5};
+
+// Thread counts under test; zero uses every core
+static const unsigned THREADS[] = {0, 1, 2, 3, 8};
+
+// Number of failed checks so far
+static unsigned failures = 0;
+
+/******************************************************************************
+ * @brief Records a failed check
+ * 
+ * @param ok      // whether the check passed
+ * @param what    // what was checked
+ * @param pattern // input pattern
+ * @param n       // input size
+ * @param threads // thread count
+ * @return void
+ *****************************************************************************/
+static void check(bool ok, const char* what, unsigned pattern, unsigned n,
+  unsigned threads)
+{
+  if (!ok)
+  {
+    std::printf("FAIL %s: %s, %u elements, %u threads\n", what,
+      PATTERN_NAMES[pattern], n, threads);
+    ++failures;
+  }
+}
+
+/******************************************************************************
+ * @brief Fills a[0, n) with one of the input patterns
+ * 
+ * @param a       // array to fill
+ * @param n       // length of array
+ * @param pattern // which Pattern
+ * @param random  // source of random values
+ * @return void
+ *****************************************************************************/
+static void fill_pattern(int* a, unsigned n, unsigned pattern,
+  std::mt19937& random)
+{
+  for (unsigned i = 0; i < n; ++i)
+  {
+    switch (pattern)
+    {
+      case RANDOM:
+        a[i] = static_cast<int>(random());
+        break;
+      case FEW_DISTINCT:
+        a[i] = static_cast<int>(random() % 4);
+        break;
+      case SORTED:
+        a[i] = static_cast<int>(i);
+        break;
+      case REVERSED:
+        a[i] = static_cast<int>(n - i);
+        break;
+      default:
+        a[i] = static_cast<int>(i < n / 2 ? i : n - i);
+        break;
+    }
+  }
+}
+
+/******************************************************************************
+ * @brief Sorts every pattern and size with every thread count and compares
+ *  with std::stable_sort and mergesort
+ * 
+ * @return int
+ *****************************************************************************/
+int main()
+{
+  std::mt19937 random(2021);
+  for (unsigned n : SIZES)
+  {
+    for (unsigned pattern = 0; pattern < PATTERN_COUNT; ++pattern)
+    {
+      std::vector<int> input(n);
+      fill_pattern(input.data(), n, pattern, random);
+      std::vector<int> expected = input;
+      std::stable_sort(expected.begin(), expected.end());
+
+      std::vector<int> serial = input;
+      mergesort(serial.data(), n);
+      check(serial == expected, "mergesort", pattern, n, 1);
+
+      for (unsigned threads : THREADS)
+      {
+        std::vector<int> a = input;
+        parallel_mergesort(a.data(), n, threads);
+        check(a == expected, "parallel_mergesort", pattern, n, threads);
+      }
+    }
+  }
+
+  std::printf("%s (%u failed checks)\n", failures ? "FAILED" : "PASSED",
+    failures);
+  return failures ? 1 : 0;
+}
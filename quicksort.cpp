@@ -1,7 +1,9 @@
 /******************************************************************************
  * @file quicksort.cpp
  * @author Jay Sharma
- * @brief Quick Sort Implementation
+ * @brief Quick Sort Implementation (introsort: median-of-three or ninther
+ *  pivots, equal keys grouped in one pass, heap sort past a depth limit and
+ *  insertion sort for short ranges)
  * @version 0.1
  * @date 2021-10-27
  * 
@@ -9,6 +11,148 @@
  * 
  *****************************************************************************/
 #include "quicksort.h"
+#include "sortutil.h"
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define QUICKSORT_HAS_AVX2
+#include <immintrin.h>
+#endif
+
+// Ranges this short are finished with insertion sort
+static const int INSERTION_SORT_THRESHOLD = 16;
+
+// Ranges at least this long pick their pivot with Tukey's ninther
+static const int NINTHER_THRESHOLD = 128;
+
+// Elements partial_insertion_sort may move before it gives up
+static const int PARTIAL_INSERTION_LIMIT = 8;
+
+// Unpartitioned spans at least this long may go through the AVX2 partition
+static const long SIMD_PARTITION_MIN = 64;
+
+// Scalar swaps made before checking whether to switch to the AVX2 partition
+static const int SIMD_PARTITION_PROBE = 16;
+
+// Parallel mode: tasks this short are sorted on one thread
+static const long PARALLEL_TASK_CUTOFF = 1 << 15;
+
+// Parallel mode: ranges this long are partitioned by several threads at once
+static const long PARALLEL_PARTITION_MIN = 1 << 20;
+
+#ifdef SORT_STATS
+// Instrumentation for benchmarks, compiled in with SORT_STATS. Relaxed 
+// atomics, since the parallel modes update them from several threads; they 
+// are touched once per partition. Comparisons are counted per thread and 
+// added to stat_compares in one go (see QuicksortCompares).
+static std::atomic<unsigned long long> stat_compares(0);
+static std::atomic<unsigned long long> stat_partitions(0);
+static std::atomic<unsigned long long> stat_partitioned(0);
+static std::atomic<unsigned long long> stat_heapsorts(0);
+static std::atomic<int> stat_max_depth(0);
+
+// Depth limit of the sort call running on this thread. Depth is counted 
+// down from it, so it is needed to turn a depth into a partition level; 
+// pool threads take it over from the call that started them.
+static thread_local int stat_limit = 0;
+
+// Comparisons made on this thread that are not in stat_compares yet. They 
+// are counted in a plain per-thread total and added in when the thread 
+// exits or an entry point returns on it.
+struct QuicksortCompares
+{
+  unsigned long long count = 0;
+
+  ~QuicksortCompares()
+  {
+    flush();
+  }
+
+  void flush()
+  {
+    stat_compares.fetch_add(count, std::memory_order_relaxed);
+    count = 0;
+  }
+};
+static thread_local QuicksortCompares stat_compares_here;
+
+// Adds the calling thread's comparisons in when an entry point returns
+struct QuicksortCall
+{
+  ~QuicksortCall()
+  {
+    stat_compares_here.flush();
+  }
+};
+
+/******************************************************************************
+ * @brief Counts one partition of [first, last)
+ * 
+ * @param first
+ * @param last
+ * @return void
+ *****************************************************************************/
+static void stat_partition(const int* first, const int* last)
+{
+  stat_partitions.fetch_add(1, std::memory_order_relaxed);
+  stat_partitioned.fetch_add(static_cast<unsigned long long>(last - first),
+    std::memory_order_relaxed);
+}
+
+/******************************************************************************
+ * @brief Records a partition made with depth left of this call's limit, 
+ *  raising the deepest level seen by any call if it is deeper
+ * 
+ * @param depth
+ * @return void
+ *****************************************************************************/
+static void stat_depth_left(int depth)
+{
+  int level = stat_limit - depth;
+  int cur = stat_max_depth.load(std::memory_order_relaxed);
+  while (cur < level && 
+    !stat_max_depth.compare_exchange_weak(cur, level, 
+      std::memory_order_relaxed));
+}
+
+#define STAT_CALL() QuicksortCall stat_call
+#define STAT_COMPARES(n) (stat_compares_here.count += (n))
+#define STAT_PARTITION(first, last) stat_partition(first, last)
+#define STAT_HEAPSORT() stat_heapsorts.fetch_add(1, std::memory_order_relaxed)
+#define STAT_DEPTH_LIMIT(depth) (stat_limit = depth)
+#define STAT_DEPTH_LEFT(depth) stat_depth_left(depth)
+#define STAT_SHARE_LIMIT(pool) (pool.stat_limit = stat_limit)
+#define STAT_ADOPT_LIMIT(pool) (stat_limit = pool.stat_limit)
+#else
+#define STAT_CALL()
+#define STAT_COMPARES(n)
+#define STAT_PARTITION(first, last)
+#define STAT_HEAPSORT()
+#define STAT_DEPTH_LIMIT(depth)
+#define STAT_DEPTH_LEFT(depth)
+#define STAT_SHARE_LIMIT(pool)
+#define STAT_ADOPT_LIMIT(pool)
+#endif
+
+/******************************************************************************
+ * @brief Compares two elements. Every comparison the sorts make goes 
+ *  through here, so SORT_STATS builds can count them.
+ * 
+ * @param x
+ * @param y
+ * @return bool
+ *****************************************************************************/
+static inline bool less(int x, int y)
+{
+  STAT_COMPARES(1);
+  return x < y;
+}
 
 /******************************************************************************
  * @brief Swap Helper Function
@@ -25,50 +169,1227 @@ static void swap(int* a, int* b)
 }
 
 /******************************************************************************
- * @brief Sets pivot as last element, sorts it, and moves everything smaller
- *  to the left and everything greater to the right
+ * @brief Orders three elements in place so that *a <= *b <= *c
+ * 
+ * @param a
+ * @param b
+ * @param c
+ * @return void
+ *****************************************************************************/
+static void sort3(int* a, int* b, int* c)
+{
+  if (less(*b, *a))
+  {
+    swap(a, b);
+  }
+  if (less(*c, *b))
+  {
+    swap(b, c);
+    if (less(*b, *a))
+    {
+      swap(a, b);
+    }
+  }
+}
+
+/******************************************************************************
+ * @brief Insertion sort that gives up once it has moved more than
+ *  PARTIAL_INSERTION_LIMIT elements. Returns true if [first, last) ended up
+ *  sorted, which makes nearly sorted input linear.
+ * 
+ * @param first
+ * @param last
+ * @return bool
+ *****************************************************************************/
+static bool partial_insertion_sort(int* first, int* last)
+{
+  int moved = 0;
+  for (int* cur = first + 1; cur < last; ++cur)
+  {
+    int value = *cur;
+    int* hole = cur;
+    while (hole > first && less(value, *(hole - 1)))
+    {
+      *hole = *(hole - 1);
+      --hole;
+    }
+    *hole = value;
+
+    moved += static_cast<int>(cur - hole);
+    if (moved > PARTIAL_INSERTION_LIMIT)
+    {
+      return cur + 1 == last;
+    }
+  }
+  return true;
+}
+
+/******************************************************************************
+ * @brief Moves the element at i down the max-heap a[0, n) until both its
+ *  children are smaller
+ * 
+ * @param a
+ * @param i
+ * @param n
+ * @return void
+ *****************************************************************************/
+static void sift_down(int* a, long i, long n)
+{
+  int value = a[i];
+  for (long child = 2 * i + 1; child < n; child = 2 * i + 1)
+  {
+    if (child + 1 < n && less(a[child], a[child + 1]))
+    {
+      ++child;
+    }
+    if (!less(value, a[child]))
+    {
+      break;
+    }
+    a[i] = a[child];
+    i = child;
+  }
+  a[i] = value;
+}
+
+/******************************************************************************
+ * @brief Sorts [first, last) with heap sort. Used once partitioning has gone
+ *  too deep, so the whole sort stays O(n log n).
+ * 
+ * @param first
+ * @param last
+ * @return void
+ *****************************************************************************/
+static void heapsort(int* first, int* last)
+{
+  STAT_HEAPSORT();
+  long n = last - first;
+  for (long i = n / 2 - 1; i >= 0; --i)
+  {
+    sift_down(first, i, n);
+  }
+  for (long i = n - 1; i > 0; --i)
+  {
+    swap(&first[0], &first[i]);
+    sift_down(first, 0, i);
+  }
+}
+
+/******************************************************************************
+ * @brief Moves the median of three (or on long ranges, Tukey's ninther) to
+ *  the first element, where the partition functions expect the pivot. Also
+ *  leaves an element no smaller than the pivot further right, which the
+ *  partition scans rely on to stop.
+ * 
+ * @param first
+ * @param last
+ * @return void
+ *****************************************************************************/
+static void choose_pivot(int* first, int* last)
+{
+  long n = last - first;
+  int* mid = first + n / 2;
+
+  if (n >= NINTHER_THRESHOLD)
+  {
+    sort3(first, mid, last - 1);
+    sort3(first + 1, mid - 1, last - 2);
+    sort3(first + 2, mid + 1, last - 3);
+    sort3(mid - 1, mid, mid + 1);
+    swap(first, mid);
+  }
+  else
+  {
+    sort3(mid, first, last - 1);
+  }
+}
+
+#ifdef QUICKSORT_HAS_AVX2
+#define QUICKSORT_AVX2 __attribute__((target("avx2")))
+
+// For every 8-bit lane mask, the lane order that puts the set lanes first
+// and the clear lanes last, each group in its original order
+struct PartitionTable
+{
+  unsigned char order[256][8];
+
+  PartitionTable()
+  {
+    for (unsigned mask = 0; mask < 256; ++mask)
+    {
+      unsigned k = 0;
+      for (unsigned lane = 0; lane < 8; ++lane)
+      {
+        if (mask & (1u << lane))
+        {
+          order[mask][k++] = static_cast<unsigned char>(lane);
+        }
+      }
+      for (unsigned lane = 0; lane < 8; ++lane)
+      {
+        if (!(mask & (1u << lane)))
+        {
+          order[mask][k++] = static_cast<unsigned char>(lane);
+        }
+      }
+    }
+  }
+};
+
+/******************************************************************************
+ * @brief Splits eight ints against the pivot and writes them to both ends:
+ *  the whole register, smaller lanes first, is stored at *left and again 
+ *  ending at *right, then both write pointers are moved past the lanes 
+ *  that belong to them.
+ * 
+ * @param v
+ * @param pivot
+ * @param order
+ * @param left
+ * @param right
+ * @return void
+ *****************************************************************************/
+QUICKSORT_AVX2 static inline void avx2_partition_store(__m256i v, 
+  __m256i pivot, const PartitionTable& order, int*& left, int*& right)
+{
+  STAT_COMPARES(8);
+  unsigned mask = static_cast<unsigned>(_mm256_movemask_ps(
+    _mm256_castsi256_ps(_mm256_cmpgt_epi32(pivot, v))));
+  __m128i lanes = _mm_loadl_epi64(
+    reinterpret_cast<const __m128i*>(order.order[mask]));
+  v = _mm256_permutevar8x32_epi32(v, _mm256_cvtepu8_epi32(lanes));
+
+  int smaller = __builtin_popcount(mask);
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(left), v);
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(right - 8), v);
+  left += smaller;
+  right -= 8 - smaller;
+}
+
+/******************************************************************************
+ * @brief Partitions [first, last) so that elements smaller than pivot come 
+ *  first, eight at a time, and returns where the rest begin. The outer 
+ *  eight elements at each end are held in registers to open a gap, and 
+ *  every further block is read from the end with less room left, so the 
+ *  stores never overwrite unread elements. Needs at least 16 elements.
+ * 
+ * @param first
+ * @param last
+ * @param pivot
+ * @return int*
+ *****************************************************************************/
+QUICKSORT_AVX2 static int* partition_avx2(int* first, int* last, int pivot)
+{
+  static const PartitionTable order;
+  __m256i pv = _mm256_set1_epi32(pivot);
+
+  __m256i head = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+  __m256i tail = _mm256_loadu_si256(
+    reinterpret_cast<const __m256i*>(last - 8));
+  int* read_l = first + 8;
+  int* read_r = last - 8;
+  int* write_l = first;
+  int* write_r = last;
+
+  while (read_r - read_l >= 8)
+  {
+    __m256i v;
+    if (read_l - write_l <= write_r - read_r)
+    {
+      v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(read_l));
+      read_l += 8;
+    }
+    else
+    {
+      read_r -= 8;
+      v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(read_r));
+    }
+    avx2_partition_store(v, pv, order, write_l, write_r);
+  }
+
+  // Fewer than eight left in the middle; copy them out before writing
+  int rest[8];
+  long rest_len = read_r - read_l;
+  for (long k = 0; k < rest_len; ++k)
+  {
+    rest[k] = read_l[k];
+  }
+  for (long k = 0; k < rest_len; ++k)
+  {
+    if (less(rest[k], pivot))
+    {
+      *write_l++ = rest[k];
+    }
+    else
+    {
+      *--write_r = rest[k];
+    }
+  }
+
+  // Exactly 16 slots remain for the two held registers
+  avx2_partition_store(head, pv, order, write_l, write_r);
+  avx2_partition_store(tail, pv, order, write_l, write_r);
+  return write_l;
+}
+#endif
+
+/******************************************************************************
+ * @brief Reports whether the AVX2 partition can run on this CPU. Checked 
+ *  once.
+ * 
+ * @return bool
+ *****************************************************************************/
+static bool use_avx2()
+{
+#ifdef QUICKSORT_HAS_AVX2
+  static const bool supported = __builtin_cpu_supports("avx2");
+  return supported;
+#else
+  return false;
+#endif
+}
+
+/******************************************************************************
+ * @brief Partitions [first, last) around the pivot in the first element:
+ *  smaller elements to the left, everything else to the right. Returns the
+ *  pivot's final position; already is set when no element had to move.
+ * 
+ * @param first
+ * @param last
+ * @param already
+ * @return int*
+ *****************************************************************************/
+static int* partition_right(int* first, int* last, bool& already)
+{
+  STAT_PARTITION(first, last);
+  int pivot = *first;
+  int* i = first;
+  int* j = last;
+
+  // choose_pivot left an element >= pivot to stop this scan
+  while (less(*++i, pivot));
+
+  // If nothing smaller was passed, the scan from the right needs a bound
+  if (i - 1 == first)
+  {
+    while (i < j && !less(*--j, pivot));
+  }
+  else
+  {
+    while (!less(*--j, pivot));
+  }
+
+  already = i >= j;
+  int* probe_i = i;
+  int* probe_j = j;
+  int swaps = 0;
+  while (i < j)
+  {
+    swap(i, j);
+    while (less(*++i, pivot));
+    while (!less(*--j, pivot));
+
+    // Once misplaced elements turn out to be dense, split the rest with
+    // AVX2. Sparse ones (nearly sorted input) stay on the scalar path,
+    // which keeps both sides in order for partial_insertion_sort.
+    if (++swaps == SIMD_PARTITION_PROBE)
+    {
+      if (j - i >= SIMD_PARTITION_MIN && 
+        (i - probe_i) + (probe_j - j) < 8 * SIMD_PARTITION_PROBE && 
+        use_avx2())
+      {
+#ifdef QUICKSORT_HAS_AVX2
+        i = partition_avx2(i, j + 1, pivot);
+        break;
+#endif
+      }
+      probe_i = i;
+      probe_j = j;
+      swaps = 0;
+    }
+  }
+
+  int* pivot_pos = i - 1;
+  *first = *pivot_pos;
+  *pivot_pos = pivot;
+  return pivot_pos;
+}
+
+/******************************************************************************
+ * @brief Partitions [first, last) around the pivot in the first element with
+ *  equal elements to the left. Only used when the element before the range
+ *  equals the pivot: nothing in the range can be smaller, so this splits it
+ *  into keys equal to the pivot, which are done, and greater keys.
+ * 
+ * @param first
+ * @param last
+ * @return int*
+ *****************************************************************************/
+static int* partition_left(int* first, int* last)
+{
+  STAT_PARTITION(first, last);
+  int pivot = *first;
+  int* i = first;
+  int* j = last;
+
+  // The pivot itself stops this scan
+  while (less(pivot, *--j));
+
+  if (j + 1 == last)
+  {
+    while (i < j && !less(pivot, *++i));
+  }
+  else
+  {
+    while (!less(pivot, *++i));
+  }
+
+  while (i < j)
+  {
+    swap(i, j);
+    while (less(pivot, *--j));
+    while (!less(pivot, *++i));
+  }
+
+  *first = *j;
+  *j = pivot;
+  return j;
+}
+
+/******************************************************************************
+ * @brief Sorts [first, last). Recurses into the smaller side of each
+ *  partition and loops on the larger, so the stack stays O(log n), and
+ *  switches to heap sort once depth partitions have been made. leftmost is
+ *  false when the element before first is a previous pivot, which is no
+ *  larger than anything in the range.
+ * 
+ * @param first
+ * @param last
+ * @param depth
+ * @param leftmost
+ * @return void
+ *****************************************************************************/
+static void introsort(int* first, int* last, int depth, bool leftmost)
+{
+  while (last - first > INSERTION_SORT_THRESHOLD)
+  {
+    if (depth == 0)
+    {
+      heapsort(first, last);
+      return;
+    }
+    --depth;
+    STAT_DEPTH_LEFT(depth);
+
+    choose_pivot(first, last);
+
+    // A pivot equal to the previous one starts a run of equal keys; group
+    // them in one pass and carry on with the greater ones
+    if (!leftmost && !less(*(first - 1), *first))
+    {
+      first = partition_left(first, last) + 1;
+      continue;
+    }
+
+    bool already;
+    int* pivot = partition_right(first, last, already);
+
+    // An untouched partition hints that the input is nearly sorted
+    if (already && partial_insertion_sort(first, pivot) &&
+      partial_insertion_sort(pivot + 1, last))
+    {
+      return;
+    }
+
+    if (pivot - first < last - (pivot + 1))
+    {
+      introsort(first, pivot, depth, leftmost);
+      first = pivot + 1;
+      leftmost = false;
+    }
+    else
+    {
+      introsort(pivot + 1, last, depth, false);
+      last = pivot;
+    }
+  }
+
+  insertion_sort(first, last, less);
+}
+
+/******************************************************************************
+ * @brief Returns how many partitions deep introsort may go on n elements
+ *  before switching to heap sort: about twice the depth of a perfectly
+ *  balanced sort
+ * 
+ * @param n
+ * @return int
+ *****************************************************************************/
+static int depth_limit(long n)
+{
+  int depth = 0;
+  for (; n > 1; n >>= 1)
+  {
+    depth += 2;
+  }
+  STAT_DEPTH_LIMIT(depth);
+  return depth;
+}
+
+/******************************************************************************
+ * @brief Reverses [first, last) if it is in non-increasing order and 
+ *  returns whether it did. The scan stops at the first ascending pair, so 
+ *  other input costs almost nothing. The scalar partition used to turn 
+ *  descending input into sorted halves on its own, but the AVX2 partition 
+ *  does not keep that order.
+ * 
+ * @param first
+ * @param last
+ * @return bool
+ *****************************************************************************/
+static bool reverse_if_descending(int* first, int* last)
+{
+  for (int* cur = first + 1; cur < last; ++cur)
+  {
+    if (less(*(cur - 1), *cur))
+    {
+      return false;
+    }
+  }
+  for (--last; first < last; ++first, --last)
+  {
+    swap(first, last);
+  }
+  return true;
+}
+
+/******************************************************************************
+ * @brief Conducts quick sort on a[l, r). Worst case O(n log n) time and
+ *  O(log n) stack; sorted and all-equal input take linear time.
  * 
  * @param a
  * @param l
  * @param r
  * @return void
  *****************************************************************************/
-static int partition (int* a, int l, int r)
+void quicksort(int* a, unsigned l, unsigned r)
 {
-  int start = a[l];
-  int i = l;
-  int j;
+  STAT_CALL();
+  if (l + 1 >= r)
+  {
+    return;
+  }
 
-  for(j = l + 1; j < r; ++j)
+  if (reverse_if_descending(a + l, a + r))
   {
-    if(a[j] <= start)
+    return;
+  }
+  introsort(a + l, a + r, depth_limit(r - l), true);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//--  PARALLEL MODE  --////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+// A range still to be sorted, with the introsort state it was split off with
+struct SortTask
+{
+  int* first;
+  int* last;
+  int depth;
+  bool leftmost;
+};
+
+// One worker's tasks. The owner works from the back; thieves take from the
+// front, where the oldest and so largest ranges are.
+struct SortQueue
+{
+  std::mutex lock;
+  std::deque<SortTask> tasks;
+};
+
+// Work-stealing pool for a single parallel_quicksort call
+struct SortPool
+{
+  std::unique_ptr<SortQueue[]> queues;
+  unsigned count;
+  std::atomic<long> pending;
+  std::atomic<unsigned> next;
+#ifdef SORT_STATS
+  int stat_limit;
+#endif
+};
+
+/******************************************************************************
+ * @brief Moves the elements of [first, last) that are smaller than pivot to
+ *  the front and returns how many there are
+ * 
+ * @param first
+ * @param last
+ * @param pivot
+ * @return long
+ *****************************************************************************/
+static long partition_block(int* first, int* last, int pivot)
+{
+#ifdef QUICKSORT_HAS_AVX2
+  if (last - first >= SIMD_PARTITION_MIN && use_avx2())
+  {
+    return partition_avx2(first, last, pivot) - first;
+  }
+#endif
+
+  int* i = first;
+  for (int* j = first; j < last; ++j)
+  {
+    if (less(*j, pivot))
     {
+      swap(i, j);
       ++i;
-      swap(&a[i], &a[j]);
     }
   }
-  swap(&a[i], &a[l]);
-  return i;
+  return i - first;
+}
+
+/******************************************************************************
+ * @brief Swaps the k-th to (end - 1)-th misplaced elements: the k-th large
+ *  element left of the split with the k-th small element right of it. Each
+ *  side lists its misplaced runs as (start, length) pairs in block order.
+ * 
+ * @param left
+ * @param right
+ * @param k
+ * @param end
+ * @return void
+ *****************************************************************************/
+static void swap_misplaced(const std::vector<std::pair<int*, long> >& left,
+  const std::vector<std::pair<int*, long> >& right, long k, long end)
+{
+  // Find where the k-th misplaced element sits on each side
+  unsigned li = 0;
+  unsigned ri = 0;
+  long lk = k;
+  long rk = k;
+  while (lk >= left[li].second)
+  {
+    lk -= left[li++].second;
+  }
+  while (rk >= right[ri].second)
+  {
+    rk -= right[ri++].second;
+  }
+
+  for (; k < end; ++k)
+  {
+    swap(left[li].first + lk, right[ri].first + rk);
+    if (++lk == left[li].second)
+    {
+      ++li;
+      lk = 0;
+    }
+    if (++rk == right[ri].second)
+    {
+      ++ri;
+      rk = 0;
+    }
+  }
 }
 
 /******************************************************************************
- * @brief Conducts quick sort
+ * @brief Partitions [first, last) around the pivot in the first element on
+ *  several threads. Each thread partitions one block; the large elements
+ *  that ended up left of the final split are then swapped with the small
+ *  ones right of it, again split between the threads. Returns the pivot's
+ *  final position.
+ * 
+ * @param first
+ * @param last
+ * @param threads
+ * @return int*
+ *****************************************************************************/
+static int* parallel_partition(int* first, int* last, unsigned threads)
+{
+  STAT_PARTITION(first, last);
+  int pivot = *first;
+  int* begin = first + 1;
+  long n = last - begin;
+  long block = (n + threads - 1) / threads;
+  std::vector<long> smaller(threads);
+
+  run_parallel(threads, [&](unsigned t)
+  {
+    long start = t * block < n ? t * block : n;
+    long end = start + block < n ? start + block : n;
+    smaller[t] = partition_block(begin + start, begin + end, pivot);
+  });
+
+  long split = 0;
+  for (unsigned t = 0; t < threads; ++t)
+  {
+    split += smaller[t];
+  }
+
+  // Collect the runs on the wrong side of the split
+  std::vector<std::pair<int*, long> > left;
+  std::vector<std::pair<int*, long> > right;
+  long misplaced = 0;
+  for (unsigned t = 0; t < threads; ++t)
+  {
+    long start = t * block < n ? t * block : n;
+    long end = start + block < n ? start + block : n;
+    long mid = start + smaller[t];
+
+    long large_end = end < split ? end : split;
+    if (mid < large_end)
+    {
+      left.push_back(std::make_pair(begin + mid, large_end - mid));
+      misplaced += large_end - mid;
+    }
+    long small_start = start > split ? start : split;
+    if (small_start < mid)
+    {
+      right.push_back(std::make_pair(begin + small_start, mid - small_start));
+    }
+  }
+
+  if (misplaced)
+  {
+    run_parallel(threads, [&](unsigned t)
+    {
+      long k = misplaced * t / threads;
+      long end = misplaced * (t + 1) / threads;
+      if (k < end)
+      {
+        swap_misplaced(left, right, k, end);
+      }
+    });
+  }
+
+  int* pivot_pos = begin + split - 1;
+  *first = *pivot_pos;
+  *pivot_pos = pivot;
+  return pivot_pos;
+}
+
+/******************************************************************************
+ * @brief Sorts one task. Ranges above PARALLEL_TASK_CUTOFF are partitioned
+ *  here and their right side is pushed back to this worker's queue for any
+ *  thread to take; the rest is finished by the sequential introsort.
+ * 
+ * @param pool
+ * @param self
+ * @param task
+ * @return void
+ *****************************************************************************/
+static void run_task(SortPool& pool, unsigned self, SortTask task)
+{
+  int* first = task.first;
+  int* last = task.last;
+
+  while (last - first > PARALLEL_TASK_CUTOFF && task.depth > 0)
+  {
+    --task.depth;
+    STAT_DEPTH_LEFT(task.depth);
+    choose_pivot(first, last);
+
+    if (!task.leftmost && !less(*(first - 1), *first))
+    {
+      first = partition_left(first, last) + 1;
+      continue;
+    }
+
+    bool already;
+    int* pivot = partition_right(first, last, already);
+
+    SortTask right = { pivot + 1, last, task.depth, false };
+    pool.pending.fetch_add(1);
+    {
+      std::lock_guard<std::mutex> guard(pool.queues[self].lock);
+      pool.queues[self].tasks.push_back(right);
+    }
+    last = pivot;
+  }
+
+  introsort(first, last, task.depth, task.leftmost);
+  pool.pending.fetch_sub(1);
+}
+
+/******************************************************************************
+ * @brief Worker loop: runs its own newest task, otherwise steals the oldest
+ *  task of another worker, until every task has finished
+ * 
+ * @param pool
+ * @param self
+ * @return void
+ *****************************************************************************/
+static void run_worker(SortPool& pool, unsigned self)
+{
+  STAT_ADOPT_LIMIT(pool);
+  while (pool.pending.load() > 0)
+  {
+    SortTask task;
+    bool found = false;
+
+    for (unsigned i = 0; i < pool.count && !found; ++i)
+    {
+      SortQueue& queue = pool.queues[(self + i) % pool.count];
+      std::lock_guard<std::mutex> guard(queue.lock);
+      if (!queue.tasks.empty())
+      {
+        if (i == 0)
+        {
+          task = queue.tasks.back();
+          queue.tasks.pop_back();
+        }
+        else
+        {
+          task = queue.tasks.front();
+          queue.tasks.pop_front();
+        }
+        found = true;
+      }
+    }
+
+    if (found)
+    {
+      run_task(pool, self, task);
+    }
+    else
+    {
+      std::this_thread::yield();
+    }
+  }
+}
+
+/******************************************************************************
+ * @brief Splits [first, last) into tasks for the pool. While a range is
+ *  long and has more than one thread to spare it is partitioned by all of
+ *  them, and the threads are divided between the two sides by size.
+ * 
+ * @param pool
+ * @param first
+ * @param last
+ * @param threads
+ * @param depth
+ * @param leftmost
+ * @return void
+ *****************************************************************************/
+static void split_range(SortPool& pool, int* first, int* last,
+  unsigned threads, int depth, bool leftmost)
+{
+  STAT_ADOPT_LIMIT(pool);
+  while (threads > 1 && depth > 0 && last - first >= PARALLEL_PARTITION_MIN)
+  {
+    --depth;
+    STAT_DEPTH_LEFT(depth);
+    choose_pivot(first, last);
+
+    if (!leftmost && !less(*(first - 1), *first))
+    {
+      first = partition_left(first, last) + 1;
+      continue;
+    }
+
+    int* pivot = parallel_partition(first, last, threads);
+
+    unsigned left_threads = static_cast<unsigned>(
+      threads * static_cast<double>(pivot - first) / (last - first) + 0.5);
+    if (left_threads < 1)
+    {
+      left_threads = 1;
+    }
+    if (left_threads > threads - 1)
+    {
+      left_threads = threads - 1;
+    }
+
+    std::thread right;
+    try
+    {
+      right = std::thread(split_range, std::ref(pool), pivot + 1, last,
+        threads - left_threads, depth, false);
+    }
+    catch(const std::system_error&)
+    {
+      split_range(pool, pivot + 1, last, threads - left_threads, depth,
+        false);
+    }
+    split_range(pool, first, pivot, left_threads, depth, leftmost);
+    if (right.joinable())
+    {
+      right.join();
+    }
+    return;
+  }
+
+  // Deal the leaves out round robin
+  SortQueue& queue = pool.queues[pool.next.fetch_add(1) % pool.count];
+  SortTask task = { first, last, depth, leftmost };
+  pool.pending.fetch_add(1);
+  std::lock_guard<std::mutex> guard(queue.lock);
+  queue.tasks.push_back(task);
+}
+
+/******************************************************************************
+ * @brief Conducts quick sort on a[l, r) with threads threads (zero uses
+ *  every core). The first partitions are each done by several threads, the
+ *  ranges they leave are sorted by a work-stealing pool, and ranges below
+ *  PARALLEL_TASK_CUTOFF use the sequential introsort.
  * 
  * @param a
  * @param l
  * @param r
+ * @param threads
  * @return void
  *****************************************************************************/
-void quicksort(int* a, unsigned l, unsigned r)
+void parallel_quicksort(int* a, unsigned l, unsigned r, unsigned threads)
 {
-  if (l < r)
+  STAT_CALL();
+  if (threads == 0)
   {
-    // Partition index
-    int pi = partition(a, l, r);
+    threads = std::thread::hardware_concurrency();
+  }
+  if (threads < 2 || r <= l || r - l <= PARALLEL_TASK_CUTOFF)
+  {
+    quicksort(a, l, r);
+    return;
+  }
+
+  SortPool pool;
+  pool.queues.reset(new SortQueue[threads]);
+  pool.count = threads;
+  pool.pending.store(0);
+  pool.next.store(0);
+
+  int depth = depth_limit(r - l);
+  STAT_SHARE_LIMIT(pool);
+  split_range(pool, a + l, a + r, threads, depth, true);
+
+  run_parallel(threads, [&](unsigned t)
+  {
+    run_worker(pool, t);
+  });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//--  SELECTION  --////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
 
-    // Before partition...
-    quicksort(a, l, pi);
-    // After partition...
-    quicksort(a, pi + 1, r);
+/******************************************************************************
+ * @brief Moves the element that belongs at nth in sorted order there, with
+ *  nothing greater before it and nothing smaller after it. Partitions only
+ *  the side holding nth, so the expected time is linear; past depth
+ *  partitions the range is heap sorted, which bounds the worst case at
+ *  O(n log n). leftmost has the same meaning as in introsort.
+ * 
+ * @param first
+ * @param last
+ * @param nth
+ * @param depth
+ * @param leftmost
+ * @return void
+ *****************************************************************************/
+static void introselect(int* first, int* last, int* nth, int depth,
+  bool leftmost)
+{
+  while (last - first > INSERTION_SORT_THRESHOLD)
+  {
+    if (depth == 0)
+    {
+      heapsort(first, last);
+      return;
+    }
+    --depth;
+    STAT_DEPTH_LEFT(depth);
+
+    choose_pivot(first, last);
+
+    // A run of keys equal to the previous pivot is already in place
+    if (!leftmost && !less(*(first - 1), *first))
+    {
+      first = partition_left(first, last) + 1;
+      if (nth < first)
+      {
+        return;
+      }
+      continue;
+    }
+
+    bool already;
+    int* pivot = partition_right(first, last, already);
+    if (pivot == nth)
+    {
+      return;
+    }
+    if (nth < pivot)
+    {
+      last = pivot;
+    }
+    else
+    {
+      first = pivot + 1;
+      leftmost = false;
+    }
+  }
+
+  insertion_sort(first, last, less);
+}
+
+/******************************************************************************
+ * @brief Places every position in nths[0, count), which must be ascending
+ *  and inside [first, last), as introselect would. Each partition splits
+ *  the positions by the pivot and only sides that still hold one are
+ *  visited, so several quantiles cost little more than one.
+ * 
+ * @param first
+ * @param last
+ * @param nths
+ * @param count
+ * @param depth
+ * @param leftmost
+ * @return void
+ *****************************************************************************/
+static void multiselect_rec(int* first, int* last, int* const* nths,
+  long count, int depth, bool leftmost)
+{
+  while (count > 0)
+  {
+    if (last - first <= INSERTION_SORT_THRESHOLD)
+    {
+      insertion_sort(first, last, less);
+      return;
+    }
+    if (depth == 0)
+    {
+      heapsort(first, last);
+      return;
+    }
+    --depth;
+    STAT_DEPTH_LEFT(depth);
+
+    choose_pivot(first, last);
+
+    if (!leftmost && !less(*(first - 1), *first))
+    {
+      first = partition_left(first, last) + 1;
+      while (count > 0 && *nths < first)
+      {
+        ++nths;
+        --count;
+      }
+      continue;
+    }
+
+    bool already;
+    int* pivot = partition_right(first, last, already);
+
+    // Positions before the pivot, and the first one after it
+    long below = 0;
+    while (below < count && nths[below] < pivot)
+    {
+      ++below;
+    }
+    long above = below < count && nths[below] == pivot ? below + 1 : below;
+
+    multiselect_rec(first, pivot, nths, below, depth, leftmost);
+    first = pivot + 1;
+    leftmost = false;
+    nths += above;
+    count -= above;
+  }
+}
+
+/******************************************************************************
+ * @brief Moves the element that belongs at a[nth] in sorted a[l, r) there;
+ *  a[l, nth) holds nothing greater and a[nth + 1, r) nothing smaller.
+ *  Expected O(n) time, O(n log n) worst case.
+ * 
+ * @param a
+ * @param l
+ * @param r
+ * @param nth
+ * @return void
+ *****************************************************************************/
+void quickselect(int* a, unsigned l, unsigned r, unsigned nth)
+{
+  STAT_CALL();
+  if (l + 1 >= r || nth < l || nth >= r)
+  {
+    return;
+  }
+
+  introselect(a + l, a + r, a + nth, depth_limit(r - l), true);
+}
+
+/******************************************************************************
+ * @brief Moves the k smallest elements of a[l, r) to a[l, l + k) in sorted
+ *  order; the rest end up in a[l + k, r) in no particular order. Selects
+ *  the k-th element first, so only k elements are sorted: O(n + k log k).
+ * 
+ * @param a
+ * @param l
+ * @param r
+ * @param k
+ * @return void
+ *****************************************************************************/
+void partial_quicksort(int* a, unsigned l, unsigned r, unsigned k)
+{
+  STAT_CALL();
+  if (k == 0 || l + 1 >= r)
+  {
+    return;
+  }
+  if (k >= r - l)
+  {
+    quicksort(a, l, r);
+    return;
   }
-}
\ No newline at end of file
+
+  int* nth = a + l + k - 1;
+  introselect(a + l, a + r, nth, depth_limit(r - l), true);
+  introsort(a + l, nth, depth_limit(k), true);
+}
+
+/******************************************************************************
+ * @brief Places several order statistics of a[l, r) at once, as quickselect
+ *  would for each of them: useful for a set of percentiles. ranks holds
+ *  count positions in [l, r) in ascending order.
+ * 
+ * @param a
+ * @param l
+ * @param r
+ * @param ranks
+ * @param count
+ * @return void
+ *****************************************************************************/
+void multiselect(int* a, unsigned l, unsigned r, const unsigned* ranks,
+  unsigned count)
+{
+  STAT_CALL();
+  if (l + 1 >= r || count == 0)
+  {
+    return;
+  }
+
+  std::vector<int*> nths;
+  nths.reserve(count);
+  for (unsigned i = 0; i < count; ++i)
+  {
+    if (ranks[i] >= l && ranks[i] < r &&
+      (nths.empty() || nths.back() < a + ranks[i]))
+    {
+      nths.push_back(a + ranks[i]);
+    }
+  }
+
+  multiselect_rec(a + l, a + r, nths.data(), static_cast<long>(nths.size()),
+    depth_limit(r - l), true);
+}
+
+/******************************************************************************
+ * @brief quickselect on threads threads (zero uses every core). While the
+ *  side holding nth is at least PARALLEL_PARTITION_MIN long it is split by
+ *  the parallel partition; the rest is left to introselect.
+ * 
+ * @param a
+ * @param l
+ * @param r
+ * @param nth
+ * @param threads
+ * @return void
+ *****************************************************************************/
+void parallel_quickselect(int* a, unsigned l, unsigned r, unsigned nth,
+  unsigned threads)
+{
+  STAT_CALL();
+  if (l + 1 >= r || nth < l || nth >= r)
+  {
+    return;
+  }
+  if (threads == 0)
+  {
+    threads = std::thread::hardware_concurrency();
+  }
+
+  int* first = a + l;
+  int* last = a + r;
+  int* target = a + nth;
+  int depth = depth_limit(r - l);
+  bool leftmost = true;
+  while (threads > 1 && depth > 0 && last - first >= PARALLEL_PARTITION_MIN)
+  {
+    --depth;
+    STAT_DEPTH_LEFT(depth);
+    choose_pivot(first, last);
+
+    if (!leftmost && !less(*(first - 1), *first))
+    {
+      first = partition_left(first, last) + 1;
+      if (target < first)
+      {
+        return;
+      }
+      continue;
+    }
+
+    int* pivot = parallel_partition(first, last, threads);
+    if (pivot == target)
+    {
+      return;
+    }
+    if (target < pivot)
+    {
+      last = pivot;
+    }
+    else
+    {
+      first = pivot + 1;
+      leftmost = false;
+    }
+  }
+
+  introselect(first, last, target, depth, leftmost);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//--  STATISTICS  --///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+/******************************************************************************
+ * @brief Returns what the quicksort and selection entry points have done 
+ *  since the last reset_quicksort_stats: partitions made, elements they 
+ *  scanned (the total that goes quadratic on bad pivots), heap sort 
+ *  fallbacks, element comparisons (the AVX2 partition counts 8 per block 
+ *  compare) and the deepest partition level any one call reached. All 
+ *  zero unless built with SORT_STATS.
+ * 
+ * @return QuicksortStats
+ *****************************************************************************/
+QuicksortStats quicksort_stats()
+{
+  QuicksortStats stats;
+#ifdef SORT_STATS
+  stats.Partitions_ = stat_partitions.load();
+  stats.Partitioned_ = stat_partitioned.load();
+  stats.HeapSorts_ = stat_heapsorts.load();
+  stats.Compares_ = stat_compares.load();
+  stats.MaxDepth_ = static_cast<unsigned>(stat_max_depth.load());
+#endif
+  return stats;
+}
+
+/******************************************************************************
+ * @brief Zeroes the counters returned by quicksort_stats
+ * 
+ * @return void
+ *****************************************************************************/
+void reset_quicksort_stats()
+{
+#ifdef SORT_STATS
+  stat_partitions.store(0);
+  stat_partitioned.store(0);
+  stat_heapsorts.store(0);
+  stat_compares.store(0);
+  stat_compares_here.count = 0;
+  stat_max_depth.store(0);
+#endif
+}
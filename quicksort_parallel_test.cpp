@@ -0,0 +1,140 @@
+/******************************************************************************
+ * @file quicksort_parallel_test.cpp
+ * @author Jay Sharma
+ * @brief Differential test for parallel_quicksort. Sorts random, few
+ *  distinct, sorted, reversed and organ pipe inputs of sizes on both sides
+ *  of the task and parallel partition cutoffs with several thread counts,
+ *  and checks each result against std::sort of the same input. Sorts a
+ *  subrange too, to check that nothing outside [l, r) is touched. Prints
+ *  one line per failed check and returns non-zero if there were any.
+ * 
+ *  Usage: quicksort_parallel_test
+ * @version 0.1
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ *****************************************************************************/
+#include "quicksort.h"
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Input patterns, in the order fill_pattern takes them
+enum Pattern {RANDOM, FEW_DISTINCT, SORTED, REVERSED, ORGAN_PIPE,
+  PATTERN_COUNT};
+static const char* const PATTERN_NAMES[] = {"random", "few_distinct",
+  "sorted", "reversed", "organ_pipe"};
+
+// Sizes under test: tiny, around the task cutoff (1 << 15) and past the
+// parallel partition minimum (1 << 20)
+static const unsigned SIZES[] = {0, 1, 2, 17, 1000, (1 << 15) - 1,
+  (1 << 15) + 1, 200003, (1 << 20) + 7, (1 << 21) + 5};
+
+// Thread counts under test; zero uses every core
+static const unsigned THREADS[] = {0, 1, 2, 3, 8};
+
+// Number of failed checks so far
+static unsigned failures = 0;
+
+/******************************************************************************
+ * @brief Records a failed check
+ * 
+ * @param ok      // whether the check passed
+ * @param what    // what was checked
+ * @param pattern // input pattern
+ * @param n       // input size
+ * @param threads // thread count
+ * @return void
+ *****************************************************************************/
+static void check(bool ok, const char* what, unsigned pattern, unsigned n,
+  unsigned threads)
+{
+  if (!ok)
+  {
+    std::printf("FAIL %s: %s, %u elements, %u threads\n", what,
+      PATTERN_NAMES[pattern], n, threads);
+    ++failures;
+  }
+}
+
+/******************************************************************************
+ * @brief Fills a[0, n) with one of the input patterns
+ * 
+ * @param a       // array to fill
+ * @param n       // length of array
+ * @param pattern // which Pattern
+ * @param random  // source of random values
+ * @return void
+ *****************************************************************************/
+static void fill_pattern(int* a, unsigned n, unsigned pattern,
+  std::mt19937& random)
+{
+  for (unsigned i = 0; i < n; ++i)
+  {
+    switch (pattern)
+    {
+      case RANDOM:
+        a[i] = static_cast<int>(random());
+        break;
+      case FEW_DISTINCT:
+        a[i] = static_cast<int>(random() % 4);
+        break;
+      case SORTED:
+        a[i] = static_cast<int>(i);
+        break;
+      case REVERSED:
+        a[i] = static_cast<int>(n - i);
+        break;
+      default:
+        a[i] = static_cast<int>(i < n / 2 ? i : n - i);
+        break;
+    }
+  }
+}
+
+/******************************************************************************
+ * @brief Sorts every pattern and size with every thread count and compares
+ *  with std::sort
+ * 
+ * @return int
+ *****************************************************************************/
+int main()
+{
+  std::mt19937 random(2021);
+  for (unsigned n : SIZES)
+  {
+    for (unsigned pattern = 0; pattern < PATTERN_COUNT; ++pattern)
+    {
+      std::vector<int> input(n);
+      fill_pattern(input.data(), n, pattern, random);
+      std::vector<int> expected = input;
+      std::sort(expected.begin(), expected.end());
+
+      for (unsigned threads : THREADS)
+      {
+        std::vector<int> a = input;
+        parallel_quicksort(a.data(), 0, n, threads);
+        check(a == expected, "parallel_quicksort", pattern, n, threads);
+      }
+
+      // Sort the middle only; the ends must be left as they were
+      if (n >= 4)
+      {
+        unsigned l = n / 4;
+        unsigned r = n - n / 4;
+        std::vector<int> a = input;
+        std::vector<int> middle = input;
+        std::sort(middle.begin() + l, middle.begin() + r);
+        parallel_quicksort(a.data(), l, r, 4);
+        check(a == middle, "parallel_quicksort of a subrange", pattern, n,
+          4);
+      }
+    }
+  }
+
+  std::printf("%s (%u failed checks)\n", failures ? "FAILED" : "PASSED",
+    failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,252 @@
+/******************************************************************************
+ * @file quicksort_select_test.cpp
+ * @author Jay Sharma
+ * @brief Differential test for the selection functions. Runs quickselect,
+ *  parallel_quickselect, partial_quicksort and multiselect on random, few
+ *  distinct, sorted, reversed and organ pipe inputs, on whole arrays and
+ *  on subranges, and checks each against std::sort of the same range: the
+ *  selected elements must match, each must split the range as
+ *  std::nth_element would, the range must still hold the same elements and
+ *  nothing outside it may move. Prints one line per failed check and
+ *  returns non-zero if there were any.
+ * 
+ *  Usage: quicksort_select_test
+ * @version 0.1
+ * @date 2026-10-17
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ *****************************************************************************/
+#include "quicksort.h"
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Input patterns, in the order fill_pattern takes them
+enum Pattern {RANDOM, FEW_DISTINCT, SORTED, REVERSED, ORGAN_PIPE,
+  PATTERN_COUNT};
+static const char* const PATTERN_NAMES[] = {"random", "few_distinct",
+  "sorted", "reversed", "organ_pipe"};
+
+// Sizes under test, from trivial to past the insertion sort, ninther and
+// SIMD partition thresholds
+static const unsigned SIZES[] = {1, 2, 3, 5, 16, 17, 64, 129, 1000, 65537};
+
+// Random ranks tried per size and pattern
+static const unsigned TRIALS = 8;
+
+// Ranks given to each multiselect call
+static const unsigned MULTISELECT_RANKS = 5;
+
+// Large enough for parallel_quickselect to use the parallel partition
+static const unsigned PARALLEL_SIZE = (1 << 21) + 5;
+
+// Number of failed checks so far
+static unsigned failures = 0;
+
+/******************************************************************************
+ * @brief Records a failed check
+ * 
+ * @param ok      // whether the check passed
+ * @param what    // what was checked
+ * @param pattern // input pattern
+ * @param n       // input size
+ * @return void
+ *****************************************************************************/
+static void check(bool ok, const char* what, unsigned pattern, unsigned n)
+{
+  if (!ok)
+  {
+    std::printf("FAIL %s: %s, %u elements\n", what, PATTERN_NAMES[pattern],
+      n);
+    ++failures;
+  }
+}
+
+/******************************************************************************
+ * @brief Fills a[0, n) with one of the input patterns
+ * 
+ * @param a       // array to fill
+ * @param n       // length of array
+ * @param pattern // which Pattern
+ * @param random  // source of random values
+ * @return void
+ *****************************************************************************/
+static void fill_pattern(int* a, unsigned n, unsigned pattern,
+  std::mt19937& random)
+{
+  for (unsigned i = 0; i < n; ++i)
+  {
+    switch (pattern)
+    {
+      case RANDOM:
+        a[i] = static_cast<int>(random());
+        break;
+      case FEW_DISTINCT:
+        a[i] = static_cast<int>(random() % 4);
+        break;
+      case SORTED:
+        a[i] = static_cast<int>(i);
+        break;
+      case REVERSED:
+        a[i] = static_cast<int>(n - i);
+        break;
+      default:
+        a[i] = static_cast<int>(i < n / 2 ? i : n - i);
+        break;
+    }
+  }
+}
+
+/******************************************************************************
+ * @brief Returns whether a[l, r) holds the same elements as sorted[l, r),
+ *  a[nth] is sorted[nth], a[l, nth) holds nothing greater than it and
+ *  a[nth + 1, r) nothing smaller
+ * 
+ * @param a      // array after selection
+ * @param sorted // the same array with [l, r) sorted
+ * @param l      // first index of the range
+ * @param r      // one past the last index of the range
+ * @param nth    // selected index
+ * @return bool
+ *****************************************************************************/
+static bool selected(const std::vector<int>& a, const std::vector<int>& sorted,
+  unsigned l, unsigned r, unsigned nth)
+{
+  if (a[nth] != sorted[nth])
+  {
+    return false;
+  }
+  for (unsigned i = l; i < r; ++i)
+  {
+    if ((i < nth && a[i] > a[nth]) || (i > nth && a[i] < a[nth]))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+/******************************************************************************
+ * @brief Returns whether a and sorted agree outside [l, r) and hold the
+ *  same elements inside it
+ * 
+ * @param a      // array after selection
+ * @param sorted // the same array with [l, r) sorted
+ * @param l      // first index of the range
+ * @param r      // one past the last index of the range
+ * @return bool
+ *****************************************************************************/
+static bool same_elements(const std::vector<int>& a,
+  const std::vector<int>& sorted, unsigned l, unsigned r)
+{
+  std::vector<int> b = a;
+  std::sort(b.begin() + l, b.begin() + r);
+  return b == sorted;
+}
+
+/******************************************************************************
+ * @brief Runs every selection function on input[l, r) with random ranks
+ *  and compares with sorted, which is input with [l, r) sorted
+ * 
+ * @param input   // array to select from
+ * @param sorted  // input with [l, r) sorted
+ * @param l       // first index of the range
+ * @param r       // one past the last index of the range
+ * @param pattern // input pattern, for messages
+ * @param random  // source of random ranks
+ * @return void
+ *****************************************************************************/
+static void check_range(const std::vector<int>& input,
+  const std::vector<int>& sorted, unsigned l, unsigned r, unsigned pattern,
+  std::mt19937& random)
+{
+  unsigned n = static_cast<unsigned>(input.size());
+  for (unsigned trial = 0; trial < TRIALS; ++trial)
+  {
+    // The ends of the range are the edge cases, so always try them
+    unsigned nth = trial == 0 ? l : trial == 1 ? r - 1 :
+      l + random() % (r - l);
+    std::vector<int> a = input;
+    quickselect(a.data(), l, r, nth);
+    check(selected(a, sorted, l, r, nth) && same_elements(a, sorted, l, r),
+      "quickselect", pattern, n);
+
+    unsigned k = trial == 0 ? 0 : trial == 1 ? r - l :
+      random() % (r - l + 1);
+    a = input;
+    partial_quicksort(a.data(), l, r, k);
+    check(std::equal(a.begin() + l, a.begin() + l + k, sorted.begin() + l) &&
+      same_elements(a, sorted, l, r), "partial_quicksort", pattern, n);
+
+    std::vector<unsigned> ranks;
+    for (unsigned i = 0; i < MULTISELECT_RANKS; ++i)
+    {
+      ranks.push_back(l + random() % (r - l));
+    }
+    std::sort(ranks.begin(), ranks.end());
+    a = input;
+    multiselect(a.data(), l, r, ranks.data(),
+      static_cast<unsigned>(ranks.size()));
+    bool ok = same_elements(a, sorted, l, r);
+    for (unsigned rank : ranks)
+    {
+      ok = ok && a[rank] == sorted[rank];
+    }
+    check(ok, "multiselect", pattern, n);
+  }
+}
+
+/******************************************************************************
+ * @brief Checks the selection functions over every pattern and size, then
+ *  parallel_quickselect on one large input per pattern
+ * 
+ * @return int
+ *****************************************************************************/
+int main()
+{
+  std::mt19937 random(2021);
+  for (unsigned n : SIZES)
+  {
+    for (unsigned pattern = 0; pattern < PATTERN_COUNT; ++pattern)
+    {
+      std::vector<int> input(n);
+      fill_pattern(input.data(), n, pattern, random);
+
+      std::vector<int> sorted = input;
+      std::sort(sorted.begin(), sorted.end());
+      check_range(input, sorted, 0, n, pattern, random);
+
+      // A range that does not start at zero
+      if (n >= 4)
+      {
+        unsigned l = n / 4;
+        unsigned r = n - n / 4;
+        sorted = input;
+        std::sort(sorted.begin() + l, sorted.begin() + r);
+        check_range(input, sorted, l, r, pattern, random);
+      }
+    }
+  }
+
+  for (unsigned pattern = 0; pattern < PATTERN_COUNT; ++pattern)
+  {
+    std::vector<int> input(PARALLEL_SIZE);
+    fill_pattern(input.data(), PARALLEL_SIZE, pattern, random);
+    std::vector<int> sorted = input;
+    std::sort(sorted.begin(), sorted.end());
+    for (unsigned nth : {0u, PARALLEL_SIZE / 3, PARALLEL_SIZE - 1})
+    {
+      std::vector<int> a = input;
+      parallel_quickselect(a.data(), 0, PARALLEL_SIZE, nth, 4);
+      check(selected(a, sorted, 0, PARALLEL_SIZE, nth) &&
+        same_elements(a, sorted, 0, PARALLEL_SIZE), "parallel_quickselect",
+        pattern, PARALLEL_SIZE);
+    }
+  }
+
+  std::printf("%s (%u failed checks)\n", failures ? "FAILED" : "PASSED",
+    failures);
+  return failures ? 1 : 0;
+}
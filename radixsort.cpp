@@ -0,0 +1,160 @@
+/******************************************************************************
+ * @file radixsort.cpp
+ * @author Jay Sharma
+ * @brief LSD Radix Sort for 32-bit integers (11-bit digits, one histogram
+ *  pass, one scratch allocation) and a front end that picks radix sort,
+ *  introsort or insertion sort for the input at hand
+ * @version 0.1
+ * @date 2026-10-16
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ *****************************************************************************/
+#include "radixsort.h"
+#include "quicksort.h"
+#include "sortutil.h"
+#include <cstring>
+
+// Bits per digit; three passes cover a 32-bit key
+static const unsigned RADIX_BITS = 11;
+static const unsigned RADIX_BUCKETS = 1u << RADIX_BITS;
+static const unsigned RADIX_PASSES = 3;
+
+// Flipping the sign bit makes signed keys order correctly as unsigned
+static const unsigned SIGN_FLIP = 0x80000000u;
+
+// sort_ints: arrays this short are sorted by insertion
+static const unsigned INSERTION_SORT_MAX = 24;
+
+// sort_ints: arrays shorter than this always go to introsort
+static const unsigned RADIX_SORT_MIN = 1536;
+
+// sort_ints: evenly spaced adjacent pairs checked for existing order
+static const unsigned ORDER_SAMPLES = 64;
+
+/******************************************************************************
+ * @brief Returns digit pass of a key, with the sign bit already flipped
+ * 
+ * @param key  // key as stored in the array
+ * @param pass // digit index, least significant first
+ * @return unsigned
+ *****************************************************************************/
+static inline unsigned digit(int key, unsigned pass)
+{
+  unsigned u = static_cast<unsigned>(key) ^ SIGN_FLIP;
+  return (u >> (pass * RADIX_BITS)) & (RADIX_BUCKETS - 1);
+}
+
+/******************************************************************************
+ * @brief Conducts LSD radix sort. All digit histograms are counted in one
+ *  read of the array, and a digit that has the same value in every key is
+ *  skipped. Passes ping-pong between the array and a single scratch
+ *  allocation, with a final copy back only if an odd number ran.
+ * 
+ * @param a   // destination array
+ * @param r   // length of array
+ * @return void
+ *****************************************************************************/
+void radixsort(int* a, unsigned r)
+{
+  if (r <= 1)
+  {
+    return;
+  }
+
+  // Count every digit in one pass
+  unsigned* counts = new unsigned[RADIX_PASSES * RADIX_BUCKETS]();
+  for (unsigned i = 0; i < r; ++i)
+  {
+    for (unsigned pass = 0; pass < RADIX_PASSES; ++pass)
+    {
+      ++counts[pass * RADIX_BUCKETS + digit(a[i], pass)];
+    }
+  }
+
+  // Allocate array once, scatter back and forth, then delete
+  int* scratch = new int[r];
+  int* src = a;
+  int* dest = scratch;
+  for (unsigned pass = 0; pass < RADIX_PASSES; ++pass)
+  {
+    unsigned* count = counts + pass * RADIX_BUCKETS;
+    if (count[digit(src[0], pass)] == r)
+    {
+      continue;
+    }
+
+    // Turn counts into starting offsets
+    unsigned offset = 0;
+    for (unsigned b = 0; b < RADIX_BUCKETS; ++b)
+    {
+      unsigned c = count[b];
+      count[b] = offset;
+      offset += c;
+    }
+
+    for (unsigned i = 0; i < r; ++i)
+    {
+      dest[count[digit(src[i], pass)]++] = src[i];
+    }
+
+    int* t = src;
+    src = dest;
+    dest = t;
+  }
+
+  if (src != a)
+  {
+    memcpy(a, src, sizeof(int) * r);
+  }
+  delete [] scratch;
+  delete [] counts;
+}
+
+/******************************************************************************
+ * @brief Samples evenly spaced adjacent pairs and reports whether they all
+ *  run the same way. Such input is likely presorted (ascending or
+ *  descending), which introsort finishes in close to linear time.
+ * 
+ * @param a   // array to sample
+ * @param r   // length of array, at least 2 * ORDER_SAMPLES
+ * @return bool
+ *****************************************************************************/
+static bool looks_presorted(const int* a, unsigned r)
+{
+  unsigned step = (r - 1) / ORDER_SAMPLES;
+  unsigned ascending = 0;
+  unsigned descending = 0;
+  for (unsigned i = 0; i < ORDER_SAMPLES; ++i)
+  {
+    unsigned k = i * step;
+    ascending += !(a[k + 1] < a[k]);
+    descending += !(a[k] < a[k + 1]);
+  }
+  return ascending == ORDER_SAMPLES || descending == ORDER_SAMPLES;
+}
+
+/******************************************************************************
+ * @brief Sorts an array with whichever engine suits it: insertion sort for
+ *  very short arrays, introsort for short or presorted ones, and radix
+ *  sort for everything else
+ * 
+ * @param a   // destination array
+ * @param r   // length of array
+ * @return void
+ *****************************************************************************/
+void sort_ints(int* a, unsigned r)
+{
+  if (r <= INSERTION_SORT_MAX)
+  {
+    insertion_sort(a, a + r);
+  }
+  else if (r < RADIX_SORT_MIN || looks_presorted(a, r))
+  {
+    quicksort(a, 0, r);
+  }
+  else
+  {
+    radixsort(a, r);
+  }
+}
@@ -0,0 +1,848 @@
+/******************************************************************************
+ * @file sort_bench.cpp
+ * @author Jay Sharma
+ * @brief Benchmark for the sort and selection entry points. Generates
+ *  random, sorted, reversed, organ-pipe, sawtooth, few-unique and all-equal
+ *  arrays from 1K to 1G elements (four times larger each step), runs every
+ *  entry point on each, checks the result and prints one CSV row per run:
+ *  ns/element, MB/s of input, comparisons per element and recursion depth
+ *  from the SORT_STATS counters, and branch and cache misses per element
+ *  from perf_event_open on Linux. Columns with nothing to report are left
+ *  empty: the counters in a build without SORT_STATS, the hardware events
+ *  where perf is not available, and both for radixsort, which does not
+ *  compare. mergesort is also run with each merge kernel forced (scalar,
+ *  branchless and, where the CPU has it, AVX2).
+ * 
+ *  For each size, a raw sequential write and a sequential read of the
+ *  input under TMPDIR come first, as the disk bandwidth to set
+ *  external_mergesort's MB/s against. Reads start from a file dropped
+ *  from the page cache, where the system allows it; writes go to the
+ *  page cache, as the external sort's own writes do.
+ * 
+ *  Build with SORT_STATS for the comparison and depth columns. Counting
+ *  slows the sorts down, so only compare ns/element between builds made
+ *  the same way. The largest size needs about 12 GB of memory and two
+ *  4 GB files under TMPDIR; pass a smaller maximum on smaller machines.
+ *  Exits non-zero if any entry point gave a wrong result.
+ * 
+ *  Usage: sort_bench [max elements] [threads]
+ * @version 0.1
+ * @date 2026-10-16
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ *****************************************************************************/
+#include "mergesort.h"
+#include "quicksort.h"
+#include "radixsort.h"
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <new>
+#include <random>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Smallest and largest array sizes; each size is four times the last
+static const unsigned long long MIN_ELEMENTS = 1ull << 10;
+static const unsigned long long MAX_ELEMENTS = 1ull << 30;
+
+// Short arrays are sorted again until this many elements have gone
+// through the entry point, and the fastest run is kept
+static const unsigned long long ELEMENTS_PER_RUN = 1ull << 22;
+
+// sawtooth: number of ascending teeth
+static const unsigned SAWTOOTH_TEETH = 16;
+
+// few-unique: number of distinct values
+static const unsigned FEW_UNIQUE_VALUES = 16;
+
+// partial_quicksort: keeps the smallest 1 / PARTIAL_FRACTION of the array
+static const unsigned PARTIAL_FRACTION = 100;
+
+// multiselect: number of evenly spaced ranks found (the deciles)
+static const unsigned SELECT_RANKS = 9;
+
+// external_mergesort: memory budget as a fraction of the input size, so
+// large inputs spill several runs
+static const unsigned EXTERNAL_MEMORY_FRACTION = 8;
+
+#ifdef SORT_STATS
+static const bool HAVE_STATS = true;
+#else
+static const bool HAVE_STATS = false;
+#endif
+
+#ifdef __linux__
+static const unsigned long long BRANCH_MISSES = PERF_COUNT_HW_BRANCH_MISSES;
+static const unsigned long long CACHE_MISSES = PERF_COUNT_HW_CACHE_MISSES;
+#else
+static const unsigned long long BRANCH_MISSES = 0;
+static const unsigned long long CACHE_MISSES = 0;
+#endif
+
+/******************************************************************************
+ * @brief One hardware event, counted in user space for the calling thread
+ *  and every thread it starts while the counter is open. Reads -1 if the
+ *  event cannot be opened: not Linux, no PMU (as in many VMs), or
+ *  perf_event_paranoid set too high.
+ *****************************************************************************/
+struct PerfCounter
+{
+  int fd;
+
+  explicit PerfCounter(unsigned long long event) : fd(-1)
+  {
+#ifdef __linux__
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = event;
+    attr.disabled = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#else
+    (void)event;
+#endif
+  }
+
+  ~PerfCounter()
+  {
+#ifdef __linux__
+    if (fd >= 0)
+    {
+      close(fd);
+    }
+#endif
+  }
+
+  PerfCounter(const PerfCounter&) = delete;
+  PerfCounter& operator=(const PerfCounter&) = delete;
+
+  void start()
+  {
+#ifdef __linux__
+    if (fd >= 0)
+    {
+      ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+  }
+
+  long long stop()
+  {
+#ifdef __linux__
+    unsigned long long count = 0;
+    if (fd >= 0)
+    {
+      ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+      if (read(fd, &count, sizeof(count)) == sizeof(count))
+      {
+        return static_cast<long long>(count);
+      }
+    }
+#endif
+    return -1;
+  }
+};
+
+// Input patterns, in the order they are run. ORGAN_PIPE ascends to the
+// middle and descends again; SAWTOOTH is SAWTOOTH_TEETH ascending runs
+// over the same values.
+enum SortPattern {RANDOM, SORTED, REVERSED, ORGAN_PIPE, SAWTOOTH,
+  FEW_UNIQUE, ALL_EQUAL, PATTERN_COUNT};
+static const char* const PATTERN_NAMES[PATTERN_COUNT] = {"random",
+  "sorted", "reversed", "organ-pipe", "sawtooth", "few-unique",
+  "all-equal"};
+
+// What one run measured. Counts are -1 where they are not available.
+struct SortResult
+{
+  double seconds;
+  long long compares;
+  long long depth;
+  long long branch_misses;
+  long long cache_misses;
+};
+
+/******************************************************************************
+ * @brief Times one call to an entry point and counts hardware events
+ *  during it, leaving set-up such as writing input files out of both
+ *****************************************************************************/
+struct SortTimer
+{
+  PerfCounter branch_misses;
+  PerfCounter cache_misses;
+  SortResult result;
+
+  SortTimer() : branch_misses(BRANCH_MISSES), cache_misses(CACHE_MISSES),
+    result()
+  {
+  }
+
+  template<class F> void measure(const F& body)
+  {
+    branch_misses.start();
+    cache_misses.start();
+    auto start = std::chrono::steady_clock::now();
+    body();
+    result.seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+    result.cache_misses = cache_misses.stop();
+    result.branch_misses = branch_misses.stop();
+  }
+};
+
+// An entry point under test. run calls it on a[0, n) inside
+// timer.measure, check returns whether a holds a right answer afterwards,
+// and counted says whether the SORT_STATS counters cover it. available,
+// if set, says whether it can run on this machine at all.
+struct SortEntry
+{
+  const char* name;
+  bool parallel;
+  void (*run)(int* a, unsigned n, unsigned threads, SortTimer& timer);
+  bool (*check)(const int* a, unsigned n);
+  bool counted;
+  bool (*available)();
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//--  INPUT PATTERNS  --///////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+/******************************************************************************
+ * @brief Fills a[0, n) with one of the input patterns. Random and
+ *  few-unique draw from a generator seeded with n, so every entry point
+ *  gets the same input.
+ * 
+ * @param a       // array to fill
+ * @param n       // length of array
+ * @param pattern // a SortPattern
+ * @return void
+ *****************************************************************************/
+static void fill_pattern(int* a, unsigned n, unsigned pattern)
+{
+  std::mt19937 rng(n);
+  unsigned tooth = (n + SAWTOOTH_TEETH - 1) / SAWTOOTH_TEETH;
+  for (unsigned i = 0; i < n; ++i)
+  {
+    unsigned value = 0;
+    switch (pattern)
+    {
+      case RANDOM:
+        value = rng();
+        break;
+      case SORTED:
+        value = i;
+        break;
+      case REVERSED:
+        value = n - i;
+        break;
+      case ORGAN_PIPE:
+        value = i < n / 2 ? i : n - i;
+        break;
+      case SAWTOOTH:
+        value = i % tooth;
+        break;
+      case FEW_UNIQUE:
+        value = rng() % FEW_UNIQUE_VALUES;
+        break;
+      default:
+        break;
+    }
+    a[i] = static_cast<int>(value);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//--  CHECKS  --///////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+/******************************************************************************
+ * @brief Returns the ranks multiselect is asked for: SELECT_RANKS evenly
+ *  spaced positions inside [0, n)
+ * 
+ * @param n // length of array
+ * @return std::vector<unsigned>
+ *****************************************************************************/
+static std::vector<unsigned> select_ranks(unsigned n)
+{
+  std::vector<unsigned> ranks(SELECT_RANKS);
+  for (unsigned i = 0; i < SELECT_RANKS; ++i)
+  {
+    ranks[i] = static_cast<unsigned>(
+      static_cast<unsigned long long>(n) * (i + 1) / (SELECT_RANKS + 1));
+  }
+  return ranks;
+}
+
+/******************************************************************************
+ * @brief Returns how many elements partial_quicksort is asked to keep
+ * 
+ * @param n // length of array
+ * @return unsigned
+ *****************************************************************************/
+static unsigned partial_count(unsigned n)
+{
+  return n / PARTIAL_FRACTION ? n / PARTIAL_FRACTION : 1;
+}
+
+/******************************************************************************
+ * @brief Returns whether a[0, n) is sorted
+ * 
+ * @param a // array to check
+ * @param n // length of array
+ * @return bool
+ *****************************************************************************/
+static bool check_sorted(const int* a, unsigned n)
+{
+  return std::is_sorted(a, a + n);
+}
+
+/******************************************************************************
+ * @brief Accepts any result, for the I/O baselines, which do not sort
+ * 
+ * @return bool
+ *****************************************************************************/
+static bool check_nothing(const int*, unsigned)
+{
+  return true;
+}
+
+/******************************************************************************
+ * @brief Returns whether a[nth] is where sorting would put it: nothing
+ *  before it is larger and nothing after it is smaller
+ * 
+ * @param a   // array to check
+ * @param n   // length of array
+ * @param nth // position to check
+ * @return bool
+ *****************************************************************************/
+static bool check_nth(const int* a, unsigned n, unsigned nth)
+{
+  int pivot = a[nth];
+  return std::none_of(a, a + nth, [&](int x) { return pivot < x; }) &&
+    std::none_of(a + nth + 1, a + n, [&](int x) { return x < pivot; });
+}
+
+/******************************************************************************
+ * @brief Checks quickselect's result: the median in place
+ * 
+ * @param a // array to check
+ * @param n // length of array
+ * @return bool
+ *****************************************************************************/
+static bool check_median(const int* a, unsigned n)
+{
+  return check_nth(a, n, n / 2);
+}
+
+/******************************************************************************
+ * @brief Checks partial_quicksort's result: the smallest partial_count(n)
+ *  elements sorted at the front
+ * 
+ * @param a // array to check
+ * @param n // length of array
+ * @return bool
+ *****************************************************************************/
+static bool check_partial(const int* a, unsigned n)
+{
+  unsigned k = partial_count(n);
+  return std::is_sorted(a, a + k) && check_nth(a, n, k - 1);
+}
+
+/******************************************************************************
+ * @brief Checks multiselect's result: every rank from select_ranks(n) in
+ *  place
+ * 
+ * @param a // array to check
+ * @param n // length of array
+ * @return bool
+ *****************************************************************************/
+static bool check_ranks(const int* a, unsigned n)
+{
+  for (unsigned rank : select_ranks(n))
+  {
+    if (!check_nth(a, n, rank))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//--  ENTRY POINTS  --/////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+/******************************************************************************
+ * @brief Times mergesort with one merge kernel forced, then goes back to
+ *  the automatic choice
+ * 
+ * @tparam kernel // the MergeKernel to force
+ * @param a     // array to sort
+ * @param n     // length of array
+ * @param timer // timer to measure the sort with
+ * @return void
+ *****************************************************************************/
+template<MergeKernel kernel>
+static void run_merge_kernel(int* a, unsigned n, unsigned, SortTimer& timer)
+{
+  set_merge_kernel(kernel);
+  timer.measure([&]() { mergesort(a, n); });
+  set_merge_kernel(MERGE_AUTO);
+}
+
+/******************************************************************************
+ * @brief Returns whether the AVX2 merge kernel can run on this CPU
+ * 
+ * @return bool
+ *****************************************************************************/
+static bool have_avx2_merge()
+{
+  bool supported = set_merge_kernel(MERGE_AVX2);
+  set_merge_kernel(MERGE_AUTO);
+  return supported;
+}
+
+#ifndef _WIN32
+// Files external_mergesort reads and writes, under TMPDIR
+static std::string external_input;
+static std::string external_output;
+
+/******************************************************************************
+ * @brief Writes a[0, n) to a file with large sequential writes. Throws
+ *  std::system_error if the file cannot be written.
+ * 
+ * @param path // file to write
+ * @param a    // array to write
+ * @param n    // length of array
+ * @return void
+ *****************************************************************************/
+static void write_file(const std::string& path, const int* a, unsigned n)
+{
+  std::FILE* file = std::fopen(path.c_str(), "wb");
+  bool written = file && std::fwrite(a, sizeof(int), n, file) == n;
+  if (file && std::fclose(file) != 0)
+  {
+    written = false;
+  }
+  if (!written)
+  {
+    throw std::system_error(errno, std::generic_category(),
+      "cannot write " + path);
+  }
+}
+
+/******************************************************************************
+ * @brief Reads n ints from a file into a with large sequential reads.
+ *  Throws std::system_error if the file cannot be read.
+ * 
+ * @param path // file to read
+ * @param a    // array to read into
+ * @param n    // length of array
+ * @return void
+ *****************************************************************************/
+static void read_file(const std::string& path, int* a, unsigned n)
+{
+  std::FILE* file = std::fopen(path.c_str(), "rb");
+  bool read_back = file && std::fread(a, sizeof(int), n, file) == n;
+  if (file)
+  {
+    std::fclose(file);
+  }
+  if (!read_back)
+  {
+    throw std::system_error(errno, std::generic_category(),
+      "cannot read " + path);
+  }
+}
+
+/******************************************************************************
+ * @brief Flushes a file to disk and drops it from the page cache, so the
+ *  next read comes from the disk. Does nothing where posix_fadvise is
+ *  missing.
+ * 
+ * @param path // file to drop
+ * @return void
+ *****************************************************************************/
+static void drop_cache(const std::string& path)
+{
+#ifdef POSIX_FADV_DONTNEED
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd >= 0)
+  {
+    fsync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+  }
+#else
+  (void)path;
+#endif
+}
+
+/******************************************************************************
+ * @brief Writes a[0, n) to the external input file, times
+ *  external_mergesort on it and reads the sorted file back into a. The
+ *  memory budget is 1 / EXTERNAL_MEMORY_FRACTION of the input, and the
+ *  input starts out of the page cache.
+ * 
+ *  Throws std::system_error if the files cannot be written or read.
+ * 
+ * @param a     // array to sort
+ * @param n     // length of array
+ * @param timer // timer to measure the sort with
+ * @return void
+ *****************************************************************************/
+static void run_external(int* a, unsigned n, unsigned, SortTimer& timer)
+{
+  write_file(external_input, a, n);
+  drop_cache(external_input);
+
+  unsigned long long memory =
+    static_cast<unsigned long long>(n) * sizeof(int) /
+    EXTERNAL_MEMORY_FRACTION;
+  timer.measure([&]()
+  {
+    external_mergesort(external_input.c_str(), external_output.c_str(),
+      memory, 0);
+  });
+
+  read_file(external_output, a, n);
+}
+
+/******************************************************************************
+ * @brief Times a sequential write of a[0, n) to a file
+ * 
+ * @param a     // array to write
+ * @param n     // length of array
+ * @param timer // timer to measure the write with
+ * @return void
+ *****************************************************************************/
+static void run_sequential_write(int* a, unsigned n, unsigned,
+  SortTimer& timer)
+{
+  timer.measure([&]() { write_file(external_output, a, n); });
+}
+
+/******************************************************************************
+ * @brief Writes a[0, n) to a file, drops it from the page cache and times
+ *  a sequential read of it back into a
+ * 
+ * @param a     // array to read into
+ * @param n     // length of array
+ * @param timer // timer to measure the read with
+ * @return void
+ *****************************************************************************/
+static void run_sequential_read(int* a, unsigned n, unsigned,
+  SortTimer& timer)
+{
+  write_file(external_input, a, n);
+  drop_cache(external_input);
+  timer.measure([&]() { read_file(external_input, a, n); });
+}
+
+// Raw file throughput, run once per size before the entry points
+static const SortEntry IO_BASELINES[] = {
+  {"sequential_write", false, run_sequential_write, check_nothing, false},
+  {"sequential_read", false, run_sequential_read, check_nothing, false},
+};
+#endif
+
+static const SortEntry ENTRIES[] = {
+  {"quicksort", false, [](int* a, unsigned n, unsigned, SortTimer& timer)
+  {
+    timer.measure([&]() { quicksort(a, 0, n); });
+  }, check_sorted, true},
+  {"parallel_quicksort", true,
+    [](int* a, unsigned n, unsigned threads, SortTimer& timer)
+  {
+    timer.measure([&]() { parallel_quicksort(a, 0, n, threads); });
+  }, check_sorted, true},
+  {"quickselect", false, [](int* a, unsigned n, unsigned, SortTimer& timer)
+  {
+    timer.measure([&]() { quickselect(a, 0, n, n / 2); });
+  }, check_median, true},
+  {"parallel_quickselect", true,
+    [](int* a, unsigned n, unsigned threads, SortTimer& timer)
+  {
+    timer.measure([&]() { parallel_quickselect(a, 0, n, n / 2, threads); });
+  }, check_median, true},
+  {"partial_quicksort", false,
+    [](int* a, unsigned n, unsigned, SortTimer& timer)
+  {
+    unsigned k = partial_count(n);
+    timer.measure([&]() { partial_quicksort(a, 0, n, k); });
+  }, check_partial, true},
+  {"multiselect", false, [](int* a, unsigned n, unsigned, SortTimer& timer)
+  {
+    std::vector<unsigned> ranks = select_ranks(n);
+    timer.measure([&]()
+    {
+      multiselect(a, 0, n, ranks.data(), SELECT_RANKS);
+    });
+  }, check_ranks, true},
+  {"mergesort", false, [](int* a, unsigned n, unsigned, SortTimer& timer)
+  {
+    timer.measure([&]() { mergesort(a, n); });
+  }, check_sorted, true},
+  {"mergesort_scalar", false, run_merge_kernel<MERGE_SCALAR>, check_sorted,
+    true},
+  {"mergesort_branchless", false, run_merge_kernel<MERGE_BRANCHLESS>,
+    check_sorted, true},
+  {"mergesort_avx2", false, run_merge_kernel<MERGE_AVX2>, check_sorted, true,
+    have_avx2_merge},
+  {"parallel_mergesort", true,
+    [](int* a, unsigned n, unsigned threads, SortTimer& timer)
+  {
+    timer.measure([&]() { parallel_mergesort(a, n, threads); });
+  }, check_sorted, true},
+  {"adaptive_mergesort", false,
+    [](int* a, unsigned n, unsigned, SortTimer& timer)
+  {
+    timer.measure([&]() { adaptive_mergesort(a, n); });
+  }, check_sorted, true},
+#ifndef _WIN32
+  {"external_mergesort", false, run_external, check_sorted, true},
+#endif
+  {"radixsort", false, [](int* a, unsigned n, unsigned, SortTimer& timer)
+  {
+    timer.measure([&]() { radixsort(a, n); });
+  }, check_sorted, false},
+  {"sort_ints", false, [](int* a, unsigned n, unsigned, SortTimer& timer)
+  {
+    timer.measure([&]() { sort_ints(a, n); });
+  }, check_sorted, true},
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//--  DRIVER  --///////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+/******************************************************************************
+ * @brief Runs one entry point on a copy of input, enough times for a
+ *  stable time, and returns the fastest run. Every run is checked; ok is
+ *  cleared if any gave a wrong result or threw.
+ * 
+ * @param entry   // entry point to run
+ * @param input   // array to run it on, left unchanged
+ * @param work    // scratch array as long as input
+ * @param threads // threads for the parallel entry points
+ * @param ok      // cleared on a wrong result
+ * @return SortResult
+ *****************************************************************************/
+static SortResult run_entry(const SortEntry& entry,
+  const std::vector<int>& input, std::vector<int>& work, unsigned threads,
+  bool& ok)
+{
+  unsigned n = static_cast<unsigned>(input.size());
+  unsigned long long repeats = ELEMENTS_PER_RUN / n ? ELEMENTS_PER_RUN / n
+                                                    : 1;
+  SortTimer timer;
+  SortResult best = SortResult();
+  best.seconds = -1.0;
+
+  for (unsigned long long i = 0; i < repeats; ++i)
+  {
+    std::copy(input.begin(), input.end(), work.begin());
+    reset_quicksort_stats();
+    reset_mergesort_stats();
+    timer.result = SortResult();
+    try
+    {
+      entry.run(work.data(), n, threads, timer);
+    }
+    catch(const std::exception& e)
+    {
+      std::fprintf(stderr, "sort_bench: %s threw: %s\n", entry.name,
+        e.what());
+      ok = false;
+      return best;
+    }
+    if (!entry.check(work.data(), n))
+    {
+      ok = false;
+    }
+
+    if (best.seconds < 0.0 || timer.result.seconds < best.seconds)
+    {
+      best = timer.result;
+      QuicksortStats q = quicksort_stats();
+      MergesortStats m = mergesort_stats();
+      best.compares = static_cast<long long>(q.Compares_ + m.Compares_);
+      best.depth = std::max(q.MaxDepth_, m.MaxDepth_);
+    }
+  }
+
+  if (!HAVE_STATS || !entry.counted)
+  {
+    best.compares = -1;
+    best.depth = -1;
+  }
+  return best;
+}
+
+/******************************************************************************
+ * @brief Prints ",count / n" with the given precision, or an empty field
+ *  if count is -1
+ * 
+ * @param count     // total count, or -1
+ * @param n         // elements it is divided by
+ * @param precision // digits after the point
+ * @return void
+ *****************************************************************************/
+static void print_per_element(long long count, unsigned long long n,
+  int precision)
+{
+  if (count < 0)
+  {
+    std::printf(",");
+    return;
+  }
+  std::printf(",%.*f", precision, static_cast<double>(count) / n);
+}
+
+/******************************************************************************
+ * @brief Runs one entry point on input, reports a wrong result on stderr
+ *  and prints its CSV row
+ * 
+ * @param entry   // entry point to run
+ * @param pattern // name of the input pattern
+ * @param input   // array to run it on, left unchanged
+ * @param work    // scratch array as long as input
+ * @param threads // threads for the parallel entry points
+ * @param ok      // cleared on a wrong result
+ * @return void
+ *****************************************************************************/
+static void run_row(const SortEntry& entry, const char* pattern,
+  const std::vector<int>& input, std::vector<int>& work, unsigned threads,
+  bool& ok)
+{
+  unsigned long long n = input.size();
+  bool entry_ok = true;
+  SortResult result = run_entry(entry, input, work, threads, entry_ok);
+  if (!entry_ok)
+  {
+    std::fprintf(stderr, "FAIL %s on %s, %llu elements\n", entry.name,
+      pattern, n);
+    ok = false;
+  }
+
+  std::printf("%s,%s,%llu,%u,%.3f,%.1f", entry.name, pattern, n,
+    entry.parallel ? threads : 1, result.seconds * 1e9 / n,
+    n * sizeof(int) / result.seconds / 1e6);
+  print_per_element(result.compares, n, 3);
+  if (result.depth < 0)
+  {
+    std::printf(",");
+  }
+  else
+  {
+    std::printf(",%lld", result.depth);
+  }
+  print_per_element(result.branch_misses, n, 4);
+  print_per_element(result.cache_misses, n, 4);
+  std::printf("\n");
+  std::fflush(stdout);
+}
+
+/******************************************************************************
+ * @brief Sweeps sizes, patterns and entry points and prints one CSV row
+ *  per run. Stops at the first size that cannot be allocated.
+ * 
+ * @param argc
+ * @param argv
+ * @return int
+ *****************************************************************************/
+int main(int argc, char* argv[])
+{
+  unsigned long long max_elements = argc > 1
+    ? std::strtoull(argv[1], 0, 10) : MAX_ELEMENTS;
+  if (max_elements > MAX_ELEMENTS)
+  {
+    max_elements = MAX_ELEMENTS;
+  }
+  unsigned threads = argc > 2 ? std::atoi(argv[2])
+                              : std::thread::hardware_concurrency();
+  if (threads == 0)
+  {
+    threads = 1;
+  }
+
+#ifndef _WIN32
+  const char* dir = std::getenv("TMPDIR");
+  std::string prefix = std::string(dir && *dir ? dir : "/tmp") +
+    "/sort_bench." + std::to_string(getpid());
+  external_input = prefix + ".in";
+  external_output = prefix + ".out";
+#endif
+
+  std::printf("entry,pattern,elements,threads,ns_element,mb_s,"
+    "compares_element,depth,branch_misses_element,cache_misses_element\n");
+
+  bool ok = true;
+  for (unsigned long long n = MIN_ELEMENTS; n <= max_elements; n *= 4)
+  {
+    std::vector<int> input;
+    std::vector<int> work;
+    try
+    {
+      input.resize(n);
+      work.resize(n);
+    }
+    catch(const std::bad_alloc&)
+    {
+      std::fprintf(stderr, "sort_bench: not enough memory for %llu "
+        "elements\n", n);
+      break;
+    }
+
+#ifndef _WIN32
+    fill_pattern(input.data(), static_cast<unsigned>(n), RANDOM);
+    for (const SortEntry& entry : IO_BASELINES)
+    {
+      run_row(entry, "-", input, work, threads, ok);
+    }
+#endif
+
+    for (unsigned pattern = 0; pattern < PATTERN_COUNT; ++pattern)
+    {
+      fill_pattern(input.data(), static_cast<unsigned>(n), pattern);
+      for (const SortEntry& entry : ENTRIES)
+      {
+        if (!entry.available || entry.available())
+        {
+          run_row(entry, PATTERN_NAMES[pattern], input, work, threads, ok);
+        }
+      }
+    }
+  }
+
+#ifndef _WIN32
+  std::remove(external_input.c_str());
+  std::remove(external_output.c_str());
+#endif
+  return ok ? 0 : 1;
+}
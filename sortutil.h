@@ -0,0 +1,95 @@
+/******************************************************************************
+ * @file sortutil.h
+ * @author Jay Sharma
+ * @brief Helpers shared by the sort implementations. Internal to the sort
+ *  translation units; not part of any sort's interface.
+ * @version 0.1
+ * @date 2026-10-16
+ * 
+ * @copyright Copyright (c) 2021
+ * 
+ *****************************************************************************/
+#ifndef SORTUTILH
+#define SORTUTILH
+
+#include <system_error>
+#include <thread>
+#include <vector>
+
+/******************************************************************************
+ * @brief Runs body(0) to body(threads - 1), each on its own thread (the
+ *  calling thread takes body(0)), and waits for all of them. If a thread
+ *  cannot be started its part runs on the calling thread instead.
+ * 
+ * @param threads // number of parts
+ * @param body    // function called with each part's index
+ * @return void
+ *****************************************************************************/
+template<class F>
+inline void run_parallel(unsigned threads, const F& body)
+{
+  std::vector<std::thread> workers;
+  workers.reserve(threads);
+  for (unsigned i = 1; i < threads; ++i)
+  {
+    try
+    {
+      workers.emplace_back(body, i);
+    }
+    catch(const std::system_error&)
+    {
+      body(i);
+    }
+  }
+  body(0);
+
+  for (std::thread& worker : workers)
+  {
+    worker.join();
+  }
+}
+
+/******************************************************************************
+ * @brief Sorts [first, last) by insertion, comparing elements with less. 
+ *  The sorts pass in their own comparison so SORT_STATS builds can count 
+ *  it.
+ * 
+ * @param first // pointer to the first element
+ * @param last  // pointer past the last element
+ * @param less  // returns whether its first argument orders before its second
+ * @return void
+ *****************************************************************************/
+template<class Less>
+inline void insertion_sort(int* first, int* last, Less less)
+{
+  if (last - first < 2)
+  {
+    return;
+  }
+
+  for (int* cur = first + 1; cur < last; ++cur)
+  {
+    int value = *cur;
+    int* hole = cur;
+    while (hole > first && less(value, *(hole - 1)))
+    {
+      *hole = *(hole - 1);
+      --hole;
+    }
+    *hole = value;
+  }
+}
+
+/******************************************************************************
+ * @brief Sorts [first, last) by insertion with the built-in <
+ * 
+ * @param first // pointer to the first element
+ * @param last  // pointer past the last element
+ * @return void
+ *****************************************************************************/
+inline void insertion_sort(int* first, int* last)
+{
+  insertion_sort(first, last, [](int x, int y) { return x < y; });
+}
+
+#endif